@@ -0,0 +1,152 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "adaptive_counter.h"
+
+#define INITIAL_CELLS 2
+
+// Each thread's position in the cell table. Seeded from the caller's
+// id on first use and rehashed whenever its cell turns out contended.
+static _Thread_local unsigned probe;
+
+static unsigned next_probe(unsigned h) {
+  // xorshift32: cheap and never maps a non-zero value to zero.
+  h ^= h << 13;
+  h ^= h >> 17;
+  h ^= h << 5;
+  return h;
+}
+
+int adaptive_counter_init(adaptive_counter_t* counter) {
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  int max_cells = INITIAL_CELLS;
+  while (max_cells < configured) { max_cells *= 2; }
+
+  atomic_store(&counter->base, 0);
+  atomic_store(&counter->cells, NULL);
+  atomic_store(&counter->cells_in_use, 0);
+  atomic_store(&counter->allocated, 0);
+  atomic_flag_clear(&counter->growing);
+  counter->max_cells = max_cells;
+  return 0;
+}
+
+void adaptive_counter_destroy(adaptive_counter_t* counter) {
+  _Atomic(counter_cell_t*)* cells = atomic_load(&counter->cells);
+  if (cells == NULL) { return; }
+  for (int c = 0; c < counter->max_cells; c++) { free(atomic_load(&cells[c])); }
+  free(cells);
+  atomic_store(&counter->cells, NULL);
+  atomic_store(&counter->cells_in_use, 0);
+  atomic_store(&counter->allocated, 0);
+}
+
+void adaptive_counter_reset(adaptive_counter_t* counter) {
+  adaptive_counter_destroy(counter);
+  atomic_store(&counter->base, 0);
+}
+
+// Allocates the pointer table the first time, or doubles the part of it
+// in use. 'seen' is the size the caller found too small; if somebody
+// else already grew past it there is nothing to do.
+static void grow(adaptive_counter_t* counter, int seen) {
+  if (atomic_flag_test_and_set_explicit(&counter->growing, memory_order_acquire)) { return; }
+
+  if (atomic_load_explicit(&counter->cells_in_use, memory_order_relaxed) == seen) {
+    if (seen == 0) {
+      _Atomic(counter_cell_t*)* cells = calloc(counter->max_cells, sizeof(*cells));
+      if (cells != NULL) {
+        // Size first: whoever acquires 'cells' must also see its size.
+        atomic_store_explicit(&counter->cells_in_use, INITIAL_CELLS, memory_order_relaxed);
+        atomic_store_explicit(&counter->cells, cells, memory_order_release);
+      }
+    } else if (seen < counter->max_cells) {
+      atomic_store_explicit(&counter->cells_in_use, seen * 2, memory_order_release);
+    }
+  }
+  atomic_flag_clear_explicit(&counter->growing, memory_order_release);
+}
+
+// Tries to add 'delta' to the cell at 'slot', creating the cell if it
+// is not there yet. Returns false if the cell CAS lost a race.
+static bool add_to_cell(adaptive_counter_t* counter, _Atomic(counter_cell_t*)* cells, int slot, long long delta) {
+  counter_cell_t* cell = atomic_load_explicit(&cells[slot], memory_order_acquire);
+  if (cell == NULL) {
+    counter_cell_t* fresh = aligned_alloc(CACHE_LINE_SIZE, sizeof(counter_cell_t));
+    if (fresh == NULL) { return false; }
+    atomic_init(&fresh->value, delta);
+
+    counter_cell_t* expected = NULL;
+    if (atomic_compare_exchange_strong_explicit(&cells[slot], &expected, fresh,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+      atomic_fetch_add_explicit(&counter->allocated, 1, memory_order_relaxed);
+      return true;
+    }
+    free(fresh);
+    cell = expected;
+  }
+
+  long long value = atomic_load_explicit(&cell->value, memory_order_relaxed);
+  return atomic_compare_exchange_strong_explicit(&cell->value, &value, value + delta,
+                                                 memory_order_relaxed, memory_order_relaxed);
+}
+
+void adaptive_counter_add(adaptive_counter_t* counter, int thread_id, long long delta) {
+  _Atomic(counter_cell_t*)* cells = atomic_load_explicit(&counter->cells, memory_order_acquire);
+
+  if (cells == NULL) {
+    long long value = atomic_load_explicit(&counter->base, memory_order_relaxed);
+    if (atomic_compare_exchange_strong_explicit(&counter->base, &value, value + delta,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+      return;
+    }
+    // Somebody else got there first: the counter is contended.
+    grow(counter, 0);
+    cells = atomic_load_explicit(&counter->cells, memory_order_acquire);
+  }
+
+  if (probe == 0) { probe = next_probe(((unsigned) thread_id + 1) * 0x9E3779B9u); }
+
+  bool collided = false;
+  for (;;) {
+    if (cells == NULL) {
+      // The table could not be allocated; stay a single atomic.
+      atomic_fetch_add_explicit(&counter->base, delta, memory_order_relaxed);
+      return;
+    }
+
+    // Loaded after acquiring 'cells', so it is never older than the table.
+    // 0 only if the table was torn down underneath us; use the base.
+    int in_use = atomic_load_explicit(&counter->cells_in_use, memory_order_acquire);
+    if (in_use == 0) {
+      atomic_fetch_add_explicit(&counter->base, delta, memory_order_relaxed);
+      return;
+    }
+    if (add_to_cell(counter, cells, probe & (in_use - 1), delta)) { return; }
+
+    if (collided) {
+      grow(counter, in_use);
+      collided = false;
+    } else {
+      collided = true;
+    }
+    probe = next_probe(probe);
+  }
+}
+
+long long adaptive_counter_read(adaptive_counter_t* counter) {
+  long long total = atomic_load_explicit(&counter->base, memory_order_relaxed);
+  _Atomic(counter_cell_t*)* cells = atomic_load_explicit(&counter->cells, memory_order_acquire);
+  if (cells == NULL) { return total; }
+
+  for (int c = 0; c < counter->max_cells; c++) {
+    counter_cell_t* cell = atomic_load_explicit(&cells[c], memory_order_acquire);
+    if (cell != NULL) { total += atomic_load_explicit(&cell->value, memory_order_relaxed); }
+  }
+  return total;
+}
+
+int adaptive_counter_footprint(adaptive_counter_t* counter) {
+  return 1 + atomic_load_explicit(&counter->allocated, memory_order_relaxed);
+}
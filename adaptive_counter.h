@@ -0,0 +1,56 @@
+#ifndef ADAPTIVE_COUNTER_H
+#define ADAPTIVE_COUNTER_H
+
+#include <stdatomic.h>
+
+#include "sharded_counter.h"
+
+// Adaptive Counter -----------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * A counter that costs one word until it is contended, in the manner of
+ * Java's LongAdder. Adds go to 'base' with a compare-and-swap. The
+ * first time that CAS fails the counter inflates: it allocates a table
+ * of cell pointers and from then on each thread adds to a cell picked
+ * by a per-thread hash, allocating cells one at a time as they are
+ * first needed. A thread whose cell CAS fails twice in a row doubles
+ * the number of cells in use, up to one per configured CPU; on every
+ * failure it also rehashes, so two threads that keep colliding drift
+ * apart.
+ *
+ * So an uncontended counter is a CAS on one line and never allocates,
+ * and memory grows only as far as contention pushes it. Cells are
+ * never moved, which keeps growth from having to copy or pause anyone:
+ * the pointer table is sized for the maximum up front and growth only
+ * raises how much of it the hash may use.
+ *
+ * Reads sum 'base' and every cell and have the same window as the
+ * sharded counter once inflated.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_llong base;
+
+  // Written once per inflation or growth step; read on every add.
+  _Alignas(CACHE_LINE_SIZE) _Atomic(_Atomic(counter_cell_t*)*) cells;
+  atomic_int cells_in_use;   // Power of two; how much of 'cells' the hash covers.
+  atomic_int allocated;      // Cells allocated so far.
+  atomic_flag growing;       // Held while inflating or growing.
+  int max_cells;
+} adaptive_counter_t;
+
+int  adaptive_counter_init(adaptive_counter_t* counter);
+void adaptive_counter_destroy(adaptive_counter_t* counter);
+
+void      adaptive_counter_add(adaptive_counter_t* counter, int thread_id, long long delta);
+long long adaptive_counter_read(adaptive_counter_t* counter);
+
+// Zeroes the counter and deflates it back to a single word. Only safe
+// while nobody is adding.
+void adaptive_counter_reset(adaptive_counter_t* counter);
+
+// Words the counter currently spans: 1 plus the cells allocated.
+int adaptive_counter_footprint(adaptive_counter_t* counter);
+
+#endif // ADAPTIVE_COUNTER_H
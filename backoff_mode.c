@@ -0,0 +1,218 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "timestamp.h"
+
+// CAS Backoff Mode -----------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The 'cas' strategy retries the moment its compare-and-swap fails,
+ * which sends the loser straight back into the fight for the line it
+ * just lost. Backing off gives the winner time to finish and thins out
+ * the next round. How long to wait is the whole question:
+ *
+ *   none          retry at once, as 'cas' does
+ *   constant      the same BACKOFF_UNIT pauses after every failure
+ *   exponential   double the wait on each failure of the same increment,
+ *                 up to BACKOFF_CAP
+ *   random        like exponential, but wait a random part of the window
+ *                 ("full jitter") so that losers do not retry in step
+ *   proportional  wait in proportion to the failures per increment this
+ *                 worker has been seeing lately, so the wait tracks the
+ *                 contention instead of starting from scratch every time
+ *
+ * Each worker does 'config->ops_per_thread' increments of one shared
+ * atomic_int with every policy at every thread count.
+ *
+ *   Fail %     failed CAS attempts over all attempts
+ *   Retries    failed attempts per successful increment
+ */
+
+#define BACKOFF_UNIT 16
+#define BACKOFF_CAP  1024
+
+// Fixed point scale of the moving average of failures per increment.
+#define RECENT_SCALE 256
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t released;
+  uint64_t  finished;
+  long long attempts;
+  long long failures;
+  uint32_t  random;       // xorshift32 state.
+  int       recent;       // Failures per increment, moving average, x RECENT_SCALE.
+} backoff_worker_t;
+
+// Returns how many pauses to wait after the 'failure'th failure (from 1)
+// of the current increment.
+typedef unsigned (*backoff_fn_t)(backoff_worker_t* self, unsigned failure);
+
+static unsigned exponential_window(unsigned failure) {
+  unsigned shift = failure - 1 < 10 ? failure - 1 : 10;
+  unsigned window = BACKOFF_UNIT << shift;
+  return window < BACKOFF_CAP ? window : BACKOFF_CAP;
+}
+
+static unsigned no_backoff(backoff_worker_t* self, unsigned failure)          { return 0; }
+static unsigned constant_backoff(backoff_worker_t* self, unsigned failure)    { return BACKOFF_UNIT; }
+static unsigned exponential_backoff(backoff_worker_t* self, unsigned failure) { return exponential_window(failure); }
+
+static unsigned random_backoff(backoff_worker_t* self, unsigned failure) {
+  uint32_t x = self->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  self->random = x;
+  return x % exponential_window(failure);
+}
+
+static unsigned proportional_backoff(backoff_worker_t* self, unsigned failure) {
+  unsigned wait = BACKOFF_UNIT * self->recent / RECENT_SCALE;
+  return wait < BACKOFF_CAP ? wait : BACKOFF_CAP;
+}
+
+typedef struct {
+  const char*  name;
+  backoff_fn_t backoff;
+} backoff_policy_t;
+
+static const backoff_policy_t policies[] = {
+  { "none",         no_backoff           },
+  { "constant",     constant_backoff     },
+  { "exponential",  exponential_backoff  },
+  { "random",       random_backoff       },
+  { "proportional", proportional_backoff },
+};
+
+static const int policy_count = sizeof(policies) / sizeof(policies[0]);
+
+static const backoff_policy_t* policy;
+static barrier_wait_fn_t start_line;
+static long long ops_per_thread;
+static backoff_worker_t* workers;
+
+static _Alignas(CACHE_LINE_SIZE) atomic_int cas_data;
+
+static void* backoff_worker(void* id) {
+  int t = (intptr_t) id;
+  backoff_worker_t* self = &workers[t];
+  backoff_fn_t backoff = policy->backoff;
+
+  start_line(t);
+  self->released = ticks_now();
+
+  for (long long op = 0; op < ops_per_thread; op++) {
+    unsigned failures = 0;
+    int expected = atomic_load_explicit(&cas_data, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak(&cas_data, &expected, expected + 1)) {
+      failures += 1;
+      for (unsigned wait = backoff(self, failures); wait > 0; wait--) { cpu_relax(); }
+    }
+
+    self->attempts += failures + 1;
+    self->failures += failures;
+    // recent += (failures - recent) / 8, rounded to nearest. It settles
+    // within 3 / RECENT_SCALE of the target, which after contention ends
+    // is below one pause of backoff.
+    int step = (int) failures * RECENT_SCALE - self->recent;
+    self->recent += (step + (step < 0 ? -4 : 4)) / 8;
+  }
+
+  self->finished = ticks_now();
+  return NULL;
+}
+
+typedef struct {
+  double mops;
+  double fail_percent;
+  double retries;
+  bool   correct;
+} backoff_result_t;
+
+static backoff_result_t run_backoff(const config_t* config, thread_pool_t* pool, int thread_count) {
+  backoff_result_t result = { 0, 0, 0, false };
+  if (barrier_arm(config->barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config->barrier->name, thread_count);
+    return result;
+  }
+
+  atomic_store(&cas_data, 0);
+  for (int t = 0; t < thread_count; t++) {
+    workers[t].attempts = 0;
+    workers[t].failures = 0;
+    workers[t].random = 2463534242u + t;
+    workers[t].recent = 0;
+  }
+  thread_pool_run(pool, thread_count, backoff_worker);
+
+  uint64_t first_release = UINT64_MAX;
+  uint64_t last_finish = 0;
+  long long attempts = 0;
+  long long failures = 0;
+  for (int t = 0; t < thread_count; t++) {
+    if (workers[t].released < first_release) { first_release = workers[t].released; }
+    if (workers[t].finished > last_finish)   { last_finish = workers[t].finished; }
+    attempts += workers[t].attempts;
+    failures += workers[t].failures;
+  }
+
+  long long total = ops_per_thread * thread_count;
+  double elapsed_ns = ticks_to_ns(last_finish - first_release);
+  result.mops = elapsed_ns > 0 ? total / elapsed_ns * 1e3 : 0;
+  result.fail_percent = attempts > 0 ? 100.0 * failures / attempts : 0;
+  result.retries = (double) failures / total;
+  result.correct = (uint32_t) atomic_load(&cas_data) == (uint32_t) total;
+  return result;
+}
+
+void backoff_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Backoff Mode--------------------------\n");
+  table_printf("|Backoff       |Thread_Count |     Mops/s |  Fail %% |  Retries | Correct |\n");
+
+  workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(backoff_worker_t) * config->max_threads);
+  if (workers == NULL) {
+    fprintf(stderr, "Unable to allocate backoff mode state.\n");
+    return;
+  }
+  start_line = barrier_wait_fn(config->barrier, config->barrier_order);
+  ops_per_thread = config->ops_per_thread;
+
+  for (int c = 0; c < config->thread_count_len; c++) {
+    int thread_count = config->thread_counts[c];
+
+    for (int p = 0; p < policy_count; p++) {
+      policy = &policies[p];
+      backoff_result_t result = run_backoff(config, pool, thread_count);
+
+      table_printf("| %-12s | %10d  | %10.2f | %7.2f | %8.3f | %-7s |\n",
+                   policy->name,
+                   thread_count,
+                   result.mops,
+                   result.fail_percent,
+                   result.retries,
+                   result.correct ? "yes" : "NO");
+
+      report_field_t fields[] = {
+        REPORT_STRING("backoff",        policy->name),
+        REPORT_INT   ("thread_count",   thread_count),
+        REPORT_INT   ("ops_per_thread", ops_per_thread),
+        REPORT_DOUBLE("mops",           result.mops),
+        REPORT_DOUBLE("fail_percent",   result.fail_percent),
+        REPORT_DOUBLE("retries_per_op", result.retries),
+        REPORT_INT   ("correct",        result.correct),
+      };
+      report_row("backoff", fields, sizeof(fields) / sizeof(fields[0]));
+    }
+  }
+
+  free(workers);
+  workers = NULL;
+}
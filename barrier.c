@@ -0,0 +1,407 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "barrier.h"
+
+void sense_barrier_init(sense_barrier_t* barrier, int participants) {
+  atomic_store_explicit(&barrier->count, 0, memory_order_relaxed);
+  barrier->participants = participants;
+  atomic_store_explicit(&barrier->sense, false, memory_order_release);
+}
+
+void barrier_local_init(barrier_local_t* local) { local->sense = false; }
+
+// Only the arrival RMW follows 'o' all the way down. The flag keeps at
+// least release/acquire whatever 'o' says: a waiter that saw the new
+// sense without the reset of 'count' would re-enter, push the count past
+// 'participants' and hang the next episode.
+ORDER_INLINE void sense_barrier_wait_ordered(sense_barrier_t* barrier, barrier_local_t* local,
+                                             memory_ordering_t o) {
+  bool sense = !local->sense;
+  local->sense = sense;
+
+  int arrived = atomic_fetch_add_explicit(&barrier->count, 1, ORDER_BOTH(o)) + 1;
+
+  if (arrived == barrier->participants) {
+    atomic_store_explicit(&barrier->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&barrier->sense, sense, o == ORDER_SEQ_CST ? memory_order_seq_cst : memory_order_release);
+    return;
+  }
+
+  unsigned spins = 0;
+  while (atomic_load_explicit(&barrier->sense, o == ORDER_SEQ_CST ? memory_order_seq_cst : memory_order_acquire) != sense) {
+    spin_pause(&spins);
+  }
+}
+
+// acq_rel: the last arriver must see everything the others did before
+// arriving, and they in turn see it through the release of 'sense'.
+void sense_barrier_wait(sense_barrier_t* barrier, barrier_local_t* local) {
+  sense_barrier_wait_ordered(barrier, local, ORDER_ACQ_REL);
+}
+
+// Spins until 'flag' holds 'sense'.
+static void wait_for_sense(atomic_bool* flag, bool sense) {
+  unsigned spins = 0;
+  while (atomic_load_explicit(flag, memory_order_acquire) != sense) {
+    spin_pause(&spins);
+  }
+}
+
+// Central --------------------------------------------------------
+//-----------------------------------------------------------------
+
+// The original start line: every thread increments one counter and then
+// spins on that same counter until it reaches the number of threads.
+// Arrivals and waiters fight over a single line. To make it reusable
+// without an outside reset the counter is never zeroed; each thread
+// instead waits for it to reach 'episode * participants'.
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) long long episode;
+} central_local_t;
+
+static _Alignas(CACHE_LINE_SIZE) atomic_llong central_count;
+static int central_participants;
+static central_local_t* central_local;
+
+static int central_init(int participants) {
+  central_local = alloc_lines(participants, sizeof(central_local_t));
+  if (central_local == NULL) { return -1; }
+  atomic_store(&central_count, 0);
+  central_participants = participants;
+  return 0;
+}
+
+static void central_wait(int id) {
+  long long target = ++central_local[id].episode * central_participants;
+  central_count += 1;
+
+  unsigned spins = 0;
+  while (central_count < target) { spin_pause(&spins); }
+}
+
+// The counter only ever grows, so even fully relaxed every waiter
+// eventually sees the target.
+ORDER_INLINE void central_wait_ordered(int id, memory_ordering_t o) {
+  long long target = ++central_local[id].episode * central_participants;
+  atomic_fetch_add_explicit(&central_count, 1, ORDER_BOTH(o));
+
+  unsigned spins = 0;
+  while (atomic_load_explicit(&central_count, ORDER_ACQUIRE(o)) < target) { spin_pause(&spins); }
+}
+ORDERED_VARIANTS(central_wait)
+
+static void central_destroy(void) {
+  free(central_local);
+  central_local = NULL;
+}
+
+// Sense-reversing ------------------------------------------------
+//-----------------------------------------------------------------
+
+static sense_barrier_t sense_barrier;
+static barrier_local_t* sense_local;
+
+static int sense_init(int participants) {
+  sense_local = alloc_lines(participants, sizeof(barrier_local_t));
+  if (sense_local == NULL) { return -1; }
+  sense_barrier_init(&sense_barrier, participants);
+  for (int t = 0; t < participants; t++) { barrier_local_init(&sense_local[t]); }
+  return 0;
+}
+
+static void sense_wait(int id) { sense_barrier_wait(&sense_barrier, &sense_local[id]); }
+
+ORDER_INLINE void sense_wait_ordered(int id, memory_ordering_t o) {
+  sense_barrier_wait_ordered(&sense_barrier, &sense_local[id], o);
+}
+ORDERED_VARIANTS(sense_wait)
+
+static void sense_destroy(void) {
+  free(sense_local);
+  sense_local = NULL;
+}
+
+// Combining tree -------------------------------------------------
+//-----------------------------------------------------------------
+
+// Threads arrive at a leaf shared with at most 'TREE_FAN_IN - 1' other
+// threads. The last to arrive at a node carries the arrival up to its
+// parent, so no counter ever sees more than 'TREE_FAN_IN' RMWs per
+// episode. Whoever completes the root releases everyone through a
+// single sense flag.
+#define TREE_FAN_IN 4
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_int count;
+  int expected;
+  int parent;       // Index of the parent node, -1 for the root.
+} tree_node_t;
+
+static tree_node_t* tree_nodes;
+static barrier_local_t* tree_local;
+static _Alignas(CACHE_LINE_SIZE) atomic_bool tree_release;
+
+static void tree_destroy(void);
+
+static int tree_init(int participants) {
+  // A tree over N leaves-worth of threads never has more than N nodes.
+  tree_nodes = alloc_lines(participants + 1, sizeof(tree_node_t));
+  tree_local = alloc_lines(participants, sizeof(barrier_local_t));
+  if (tree_nodes == NULL || tree_local == NULL) {
+    tree_destroy();
+    return -1;
+  }
+
+  // Build level by level. Leaves occupy the front of the array, so
+  // thread 't' arrives at node 't / TREE_FAN_IN'.
+  int level_start = 0;
+  int level_width = (participants + TREE_FAN_IN - 1) / TREE_FAN_IN;
+  int children = participants;
+  for (int n = 0; n < level_width; n++) {
+    int remaining = children - n * TREE_FAN_IN;
+    tree_nodes[n].expected = remaining < TREE_FAN_IN ? remaining : TREE_FAN_IN;
+  }
+  while (level_width > 1) {
+    int parent_start = level_start + level_width;
+    int parent_width = (level_width + TREE_FAN_IN - 1) / TREE_FAN_IN;
+    for (int n = 0; n < level_width; n++) {
+      tree_nodes[level_start + n].parent = parent_start + n / TREE_FAN_IN;
+    }
+    for (int n = 0; n < parent_width; n++) {
+      int remaining = level_width - n * TREE_FAN_IN;
+      tree_nodes[parent_start + n].expected = remaining < TREE_FAN_IN ? remaining : TREE_FAN_IN;
+    }
+    level_start = parent_start;
+    level_width = parent_width;
+  }
+  tree_nodes[level_start].parent = -1;
+
+  atomic_store(&tree_release, false);
+  return 0;
+}
+
+static void tree_wait(int id) {
+  bool sense = !tree_local[id].sense;
+  tree_local[id].sense = sense;
+
+  tree_node_t* node = &tree_nodes[id / TREE_FAN_IN];
+  for (;;) {
+    int arrived = atomic_fetch_add_explicit(&node->count, 1, memory_order_acq_rel) + 1;
+    if (arrived != node->expected) { break; }
+
+    atomic_store_explicit(&node->count, 0, memory_order_relaxed);
+    if (node->parent < 0) {
+      atomic_store_explicit(&tree_release, sense, memory_order_release);
+      return;
+    }
+    node = &tree_nodes[node->parent];
+  }
+
+  wait_for_sense(&tree_release, sense);
+}
+
+static void tree_destroy(void) {
+  free(tree_nodes);
+  free(tree_local);
+  tree_nodes = NULL;
+  tree_local = NULL;
+}
+
+// Dissemination --------------------------------------------------
+//-----------------------------------------------------------------
+
+// In round 'r' thread 'i' signals thread 'i + 2^r' and waits for a
+// signal from thread 'i - 2^r'. After ceil(log2 N) rounds every thread
+// has transitively heard from every other. A partner can run at most one
+// episode ahead, so flags alternate between two sets ('parity') and the
+// sense flips every other episode.
+#define MAX_ROUNDS 32
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_bool flags[2][MAX_ROUNDS];
+  int  parity;
+  bool sense;
+} dissemination_local_t;
+
+static dissemination_local_t* dissemination_local;
+static int dissemination_participants;
+static int dissemination_rounds;
+
+static int dissemination_init(int participants) {
+  dissemination_local = alloc_lines(participants, sizeof(dissemination_local_t));
+  if (dissemination_local == NULL) { return -1; }
+  for (int t = 0; t < participants; t++) { dissemination_local[t].sense = true; }
+
+  dissemination_participants = participants;
+  dissemination_rounds = 0;
+  while ((1 << dissemination_rounds) < participants) { dissemination_rounds += 1; }
+  return 0;
+}
+
+static void dissemination_wait(int id) {
+  dissemination_local_t* self = &dissemination_local[id];
+  int parity = self->parity;
+  bool sense = self->sense;
+
+  for (int r = 0; r < dissemination_rounds; r++) {
+    int partner = (id + (1 << r)) % dissemination_participants;
+    atomic_store_explicit(&dissemination_local[partner].flags[parity][r], sense, memory_order_release);
+    wait_for_sense(&self->flags[parity][r], sense);
+  }
+
+  if (parity == 1) { self->sense = !sense; }
+  self->parity = 1 - parity;
+}
+
+static void dissemination_destroy(void) {
+  free(dissemination_local);
+  dissemination_local = NULL;
+}
+
+// Tournament -----------------------------------------------------
+//-----------------------------------------------------------------
+
+// In round 'r' the thread whose index is a multiple of 2^(r+1) waits for
+// its opponent 'i + 2^r' to report in; the opponent drops out and waits
+// for the release. Thread 0 wins every round and releases everyone.
+// Unlike the tree, every flag has exactly one writer and one reader.
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_bool rounds[MAX_ROUNDS];
+  bool sense;
+} tournament_local_t;
+
+static tournament_local_t* tournament_local;
+static int tournament_participants;
+static _Alignas(CACHE_LINE_SIZE) atomic_bool tournament_release;
+
+static int tournament_init(int participants) {
+  tournament_local = alloc_lines(participants, sizeof(tournament_local_t));
+  if (tournament_local == NULL) { return -1; }
+  tournament_participants = participants;
+  atomic_store(&tournament_release, false);
+  return 0;
+}
+
+static void tournament_wait(int id) {
+  tournament_local_t* self = &tournament_local[id];
+  bool sense = !self->sense;
+  self->sense = sense;
+
+  for (int r = 0; (1 << r) < tournament_participants; r++) {
+    int stride = 1 << r;
+    if (id % (stride << 1) == 0) {
+      // Winner: wait for the opponent if there is one.
+      if (id + stride < tournament_participants) { wait_for_sense(&self->rounds[r], sense); }
+    } else {
+      // Loser: report to the winner and wait to be released.
+      atomic_store_explicit(&tournament_local[id - stride].rounds[r], sense, memory_order_release);
+      wait_for_sense(&tournament_release, sense);
+      return;
+    }
+  }
+
+  atomic_store_explicit(&tournament_release, sense, memory_order_release);
+}
+
+static void tournament_destroy(void) {
+  free(tournament_local);
+  tournament_local = NULL;
+}
+
+// pthread_barrier_t ----------------------------------------------
+//-----------------------------------------------------------------
+
+static pthread_barrier_t posix_barrier;
+
+static int  posix_init(int participants) { return pthread_barrier_init(&posix_barrier, NULL, participants); }
+static void posix_wait(int _ignored)     { pthread_barrier_wait(&posix_barrier); }
+static void posix_destroy(void)          { pthread_barrier_destroy(&posix_barrier); }
+
+// Futex ----------------------------------------------------------
+//-----------------------------------------------------------------
+
+// A counting barrier whose waiters spin briefly and then sleep in the
+// kernel on a generation word. The last arriver bumps the generation
+// and wakes everyone. Cheap on CPU time, expensive in release skew.
+#define FUTEX_SPIN_LIMIT 128
+
+static _Alignas(CACHE_LINE_SIZE) atomic_int futex_count;
+static int futex_participants;
+static _Alignas(CACHE_LINE_SIZE) atomic_uint futex_generation;
+
+static int futex_init(int participants) {
+  atomic_store(&futex_count, 0);
+  atomic_store(&futex_generation, 0);
+  futex_participants = participants;
+  return 0;
+}
+
+static void futex_barrier_wait(int _ignored) {
+  // Read the generation before arriving: it cannot move until we have.
+  unsigned generation = atomic_load_explicit(&futex_generation, memory_order_acquire);
+
+  if (atomic_fetch_add_explicit(&futex_count, 1, memory_order_acq_rel) + 1 == futex_participants) {
+    atomic_store_explicit(&futex_count, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&futex_generation, 1, memory_order_release);
+    futex_wake(&futex_generation, INT_MAX);
+    return;
+  }
+
+  unsigned spins = 0;
+  while (atomic_load_explicit(&futex_generation, memory_order_acquire) == generation) {
+    if (++spins < FUTEX_SPIN_LIMIT) { cpu_relax(); }
+    else                            { futex_wait(&futex_generation, generation); }
+  }
+}
+
+static void futex_destroy(void) {}
+
+// Algorithm Table ------------------------------------------------
+//-----------------------------------------------------------------
+
+const barrier_algorithm_t barrier_algorithms[] = {
+  { "central",       "single counter, spin on the counter",       central_init,       central_wait,       central_destroy,       central_wait_by_order },
+  { "sense",         "sense-reversing counter, padded flag",      sense_init,         sense_wait,         sense_destroy,         sense_wait_by_order   },
+  { "tree",          "combining tree, fan-in 4, global release",  tree_init,          tree_wait,          tree_destroy,          NULL                  },
+  { "dissemination", "log2(N) rounds of pairwise flags",          dissemination_init, dissemination_wait, dissemination_destroy, NULL                  },
+  { "tournament",    "static pairings, champion releases",        tournament_init,    tournament_wait,    tournament_destroy,    NULL                  },
+  { "pthread",       "pthread_barrier_t",                         posix_init,         posix_wait,         posix_destroy,         NULL                  },
+  { "futex",         "counter, brief spin then futex sleep",      futex_init,         futex_barrier_wait, futex_destroy,         NULL                  },
+};
+
+const int barrier_algorithm_count = sizeof(barrier_algorithms) / sizeof(barrier_algorithms[0]);
+
+const barrier_algorithm_t* find_barrier(const char* name) {
+  for (int b = 0; b < barrier_algorithm_count; b++) {
+    if (strcmp(barrier_algorithms[b].name, name) == 0) { return &barrier_algorithms[b]; }
+  }
+  return NULL;
+}
+
+barrier_wait_fn_t barrier_wait_fn(const barrier_algorithm_t* algorithm, memory_ordering_t ordering) {
+  if (ordering == ORDER_DEFAULT || algorithm->ordered_wait == NULL) { return algorithm->wait; }
+  return algorithm->ordered_wait[ordering];
+}
+
+static const barrier_algorithm_t* armed = NULL;
+static int armed_participants = 0;
+
+int barrier_arm(const barrier_algorithm_t* algorithm, int participants) {
+  if (armed == algorithm && armed_participants == participants) { return 0; }
+
+  barrier_disarm();
+  if (algorithm->init(participants) != 0) { return -1; }
+  armed = algorithm;
+  armed_participants = participants;
+  return 0;
+}
+
+void barrier_disarm(void) {
+  if (armed != NULL) { armed->destroy(); }
+  armed = NULL;
+  armed_participants = 0;
+}
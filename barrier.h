@@ -0,0 +1,101 @@
+#ifndef BARRIER_H
+#define BARRIER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "ordering.h"
+#include "platform.h"
+
+// Sense-Reversing Barrier ----------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * A counting barrier that can be crossed over and over without anyone
+ * resetting it from the outside. Every thread keeps a private 'sense'
+ * that it flips on the way in. The last thread to arrive zeroes the
+ * count and then publishes its sense through the shared flag. Everyone
+ * else spins until the flag matches their own sense. The next episode
+ * waits for the opposite value, so a fast thread that re-enters before a
+ * slow one has left cannot be confused by the previous release.
+ *
+ * The arrival counter and the release flag each sit on their own cache
+ * line: arrivals hammer 'count' with RMWs while the waiters only read
+ * 'sense', so the spinning never competes with the arrivals.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_int count;
+  int participants;
+  _Alignas(CACHE_LINE_SIZE) atomic_bool sense;
+} sense_barrier_t;
+
+// Per-thread sense. Padded so that neighbouring threads' senses never
+// share a line.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) bool sense;
+} barrier_local_t;
+
+// (Re)arms the barrier for 'participants' threads. Every local sense
+// used with it must be reset with 'barrier_local_init' at the same time.
+// Must not be called while any thread is inside the barrier.
+void sense_barrier_init(sense_barrier_t* barrier, int participants);
+void barrier_local_init(barrier_local_t* local);
+
+void sense_barrier_wait(sense_barrier_t* barrier, barrier_local_t* local);
+
+// Barrier Algorithms ---------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The barrier is the start line of every experiment, so how tightly it
+ * releases its waiters decides how many of them race on the counter.
+ * Each algorithm below trades arrival cost, release latency and
+ * coherence traffic differently:
+ *
+ *   central        one counter that everybody increments and spins on
+ *   sense          the sense-reversing barrier above
+ *   tree           combining tree of small counters, global release flag
+ *   dissemination  log2(N) rounds of pairwise signalling, no counters
+ *   tournament     statically paired winners and losers, global release
+ *   pthread        pthread_barrier_t
+ *   futex          counter with a futex sleep instead of a spin
+ *
+ * Like the increment strategies, every algorithm keeps its state in
+ * file-level statics, so only one barrier can be armed at a time.
+ * Workers identify themselves by their index, 0..participants-1.
+ * 'central' and 'sense' also provide 'ordered_wait', their wait at each
+ * memory ordering level (see ordering.h).
+ */
+
+typedef void (*barrier_wait_fn_t)(int id);
+
+typedef struct {
+  const char* name;
+  const char* description;
+
+  int  (*init)(int participants);   // Returns 0 on success, cleaning up on failure.
+  barrier_wait_fn_t wait;
+  void (*destroy)(void);
+
+  const barrier_wait_fn_t* ordered_wait;
+} barrier_algorithm_t;
+
+extern const barrier_algorithm_t barrier_algorithms[];
+extern const int barrier_algorithm_count;
+
+// Returns the algorithm called 'name' or NULL if there is none.
+const barrier_algorithm_t* find_barrier(const char* name);
+
+// The wait 'algorithm' performs under 'ordering'. ORDER_DEFAULT, or an
+// algorithm without ordered variants, gives 'algorithm->wait'.
+barrier_wait_fn_t barrier_wait_fn(const barrier_algorithm_t* algorithm, memory_ordering_t ordering);
+
+// Makes 'algorithm' the armed barrier for 'participants' threads,
+// tearing down whatever was armed before. Does nothing if it is already
+// armed for that many threads. Must not be called while any thread is
+// inside a barrier. Returns 0 on success.
+int  barrier_arm(const barrier_algorithm_t* algorithm, int participants);
+void barrier_disarm(void);
+
+#endif // BARRIER_H
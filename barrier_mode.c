@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "stats.h"
+
+// Barrier Latency Mode -------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Every worker crosses the barrier 'episodes + 1' times back to back and
+ * timestamps each release. The first crossing only absorbs the skew of
+ * the pool waking its workers and is not counted. For each episode the
+ * release skew is the gap between the first and the last worker to get
+ * out; the episode latency is the wall time of all counted episodes
+ * divided by their number. The timestamp itself (a vDSO clock read)
+ * is part of every episode.
+ */
+
+static const barrier_algorithm_t* algorithm;
+static int episodes;
+
+// release_ns[t * (episodes + 1) + e] is worker t's release from episode e.
+static long long* release_ns;
+
+// Distribution of per-episode skew for the current run.
+static log_histogram_t skew_histogram;
+
+static void* barrier_worker(void* id) {
+  int t = (intptr_t) id;
+  long long* releases = &release_ns[(size_t) t * (episodes + 1)];
+
+  for (int e = 0; e <= episodes; e++) {
+    algorithm->wait(t);
+    releases[e] = now_ns();
+  }
+  return NULL;
+}
+
+static void print_barrier_stats(int thread_count) {
+  long long first_release = INT64_MAX;
+  long long last_release = 0;
+  double skew_total = 0;
+  log_histogram_init(&skew_histogram);
+
+  for (int e = 0; e <= episodes; e++) {
+    long long earliest = INT64_MAX;
+    long long latest = 0;
+    for (int t = 0; t < thread_count; t++) {
+      long long release = release_ns[(size_t) t * (episodes + 1) + e];
+      if (release < earliest) { earliest = release; }
+      if (release > latest)   { latest = release; }
+    }
+
+    if (e == 0) { first_release = earliest; continue; }
+    if (e == episodes) { last_release = latest; }
+
+    long long skew = latest - earliest;
+    skew_total += skew;
+    log_histogram_record(&skew_histogram, skew);
+  }
+
+  percentiles_t skew = log_histogram_percentiles(&skew_histogram);
+  double latency = (double) (last_release - first_release) / episodes;
+  table_printf("| %-13s | %10d  | %10d  | %12.1f | %14.1f | %10.1f | %10.1f | %10.1f | %13.0f |\n",
+               algorithm->name,
+               thread_count,
+               episodes,
+               latency,
+               skew_total / episodes,
+               skew.p50,
+               skew.p99,
+               skew.p999,
+               skew.max);
+
+  report_field_t fields[] = {
+    REPORT_STRING("barrier",      algorithm->name),
+    REPORT_INT   ("thread_count", thread_count),
+    REPORT_INT   ("episodes",     episodes),
+    REPORT_DOUBLE("latency_ns",   latency),
+    REPORT_DOUBLE("skew_mean_ns", skew_total / episodes),
+    REPORT_PERCENTILES("skew", skew),
+  };
+  report_row("barrier", fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+void barrier_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Barrier Mode--------------------------\n");
+  table_printf("|Barrier        |Thread_Count |   Episodes  | Latency (ns) | Mean Skew (ns) | p50 (ns)   | p99 (ns)   | p99.9 (ns) | Max Skew (ns) |\n");
+
+  episodes = config->barrier_episodes;
+  release_ns = calloc((size_t) config->max_threads * (episodes + 1), sizeof(long long));
+  if (release_ns == NULL) {
+    fprintf(stderr, "Unable to allocate %d episodes of timestamps.\n", episodes);
+    return;
+  }
+
+  for (int b = 0; b < barrier_algorithm_count; b++) {
+    algorithm = &barrier_algorithms[b];
+
+    for (int c = 0; c < config->thread_count_len; c++) {
+      int thread_count = config->thread_counts[c];
+      if (barrier_arm(algorithm, thread_count) != 0) {
+        fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", algorithm->name, thread_count);
+        continue;
+      }
+
+      thread_pool_run(pool, thread_count, barrier_worker);
+      print_barrier_stats(thread_count);
+    }
+  }
+
+  barrier_disarm();
+  free(release_ns);
+  release_ns = NULL;
+}
@@ -0,0 +1,456 @@
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+
+// Caution: program run-time is proporional to the magnitude of these
+// values due to atomic contention. That is... bigger values mean
+// longer run-times. These settings seem like a good trade off.
+#define DEFAULT_EXPERIMENTS 100
+#define DEFAULT_BARRIER_EPISODES 1000
+#define DEFAULT_OPS_PER_THREAD 1000000
+#define DEFAULT_LOCK_MS 100
+#define DEFAULT_ROW_BUDGET 10.0
+#define MAX_OPS_PER_THREAD 1000000000LL
+
+static void usage(const char* program) {
+  printf("Usage: %s [options]\n", program);
+  printf("\n");
+  printf("  -m, --modes=LIST          comma separated modes to run: complex, simple, barrier,\n");
+  printf("                            throughput, pingpong, stride, ordering, locks,\n");
+  printf("                            counters, combining, backoff, window\n");
+  printf("                            (default: complex,simple)\n");
+  printf("  -t, --threads=START[:STOP[:STEP]]\n");
+  printf("                            thread counts to sweep (default: 1:<online cpus>:1)\n");
+  printf("  -g, --geometric           multiply by STEP instead of adding it (default STEP 2)\n");
+  printf("  -e, --experiments=N       experiments per thread count and strategy (default: %d)\n",
+         DEFAULT_EXPERIMENTS);
+  printf("      --ci-width=W          run each complex mode row until the 95%% interval\n");
+  printf("                            on its failure probability is at most W wide,\n");
+  printf("                            0 < W < 1, instead of a fixed -e\n");
+  printf("      --row-budget=SECONDS  give up on --ci-width after this long per row\n");
+  printf("                            (default: %g)\n", DEFAULT_ROW_BUDGET);
+  printf("      --budget=SECONDS      share SECONDS among all complex mode rows so they\n");
+  printf("                            reach similar precision, instead of a fixed -e\n");
+  printf("  -n, --ops=N               increments per thread in throughput mode, 1 to 1e9\n");
+  printf("                            (default: %d)\n", DEFAULT_OPS_PER_THREAD);
+  printf("  -s, --strategies=LIST     comma separated strategies, or 'all' (default: all)\n");
+  printf("      --strides=LIST        counter spacing in stride mode, in bytes or 'packed'\n");
+  printf("                            and 'page' (default: packed,64,128,page)\n");
+  printf("      --windows=LIST        delay lengths between load and store in window mode\n");
+  printf("                            (default: 0,1,4,16,64,256,1024)\n");
+  printf("      --locks=LIST          comma separated locks for lock mode, or 'all'\n");
+  printf("                            (default: all)\n");
+  printf("      --lock-ms=N           milliseconds per lock and thread count (default: %d)\n",
+         DEFAULT_LOCK_MS);
+  printf("  -b, --barrier=NAME        barrier used as the start line (default: sense)\n");
+  printf("      --barrier-episodes=N  barrier crossings per run in barrier mode (default: %d)\n",
+         DEFAULT_BARRIER_EPISODES);
+  printf("      --order=ORDER         memory ordering of the increment: default, relaxed,\n");
+  printf("                            acquire-release, acq_rel, seq_cst (default: default)\n");
+  printf("      --barrier-order=ORDER memory ordering of the start line (default: default)\n");
+  printf("      --perf                count cycles, instructions and cache misses per\n");
+  printf("                            increment in complex and throughput mode\n");
+  printf("      --hitm-event=RAW      raw perf encoding of this CPU's HITM event, e.g.\n");
+  printf("                            0x04d2 on Skylake (implies --perf)\n");
+  printf("  -p, --pin=POLICY          worker placement, see below (default: round-robin)\n");
+  printf("  -o, --format=FORMAT       output format: table, csv, json (default: table)\n");
+  printf("      --output=FILE         write the csv or json report to FILE and keep the\n");
+  printf("                            tables on stdout (default: report replaces tables)\n");
+  printf("      --fork-join           create and join threads for every experiment\n");
+  printf("                            instead of re-using a pool\n");
+  printf("  -h, --help                show this message\n");
+  printf("\n");
+  printf("Strategies:\n");
+  for (int s = 0; s < increment_strategy_count; s++) {
+    printf("  %-10s %s\n", increment_strategies[s].name, increment_strategies[s].description);
+  }
+  printf("\n");
+  printf("Locks:\n");
+  for (int l = 0; l < lock_algorithm_count; l++) {
+    printf("  %-16s %s\n", lock_algorithms[l].name, lock_algorithms[l].description);
+  }
+  printf("\n");
+  printf("Barriers:\n");
+  for (int b = 0; b < barrier_algorithm_count; b++) {
+    printf("  %-14s %s\n", barrier_algorithms[b].name, barrier_algorithms[b].description);
+  }
+  printf("\n");
+  printf("Placement policies:\n");
+  for (int p = 0; p < pin_policy_count; p++) {
+    printf("  %-12s %s\n", pin_policy_name((pin_policy_t) p), pin_policy_description((pin_policy_t) p));
+  }
+}
+
+// Parses a strictly positive int. Returns 0 on success.
+static int parse_positive(const char* text, int* out) {
+  char* end;
+  errno = 0;
+  long value = strtol(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || value <= 0 || value > INT_MAX) { return -1; }
+  *out = (int) value;
+  return 0;
+}
+
+// Parses an operation count between 1 and MAX_OPS_PER_THREAD. Accepts
+// scientific notation ("1e9") because nobody wants to count zeros.
+static int parse_ops(const char* text, long long* out) {
+  char* end;
+  errno = 0;
+  double value = strtod(text, &end);
+  if (errno != 0 || end == text || *end != '\0') { return -1; }
+  if (value < 1 || value > MAX_OPS_PER_THREAD || value != (long long) value) { return -1; }
+  *out = (long long) value;
+  return 0;
+}
+
+// Parses a double in (0, max). Returns 0 on success.
+static int parse_below(const char* text, double max, double* out) {
+  char* end;
+  errno = 0;
+  double value = strtod(text, &end);
+  if (errno != 0 || end == text || *end != '\0' || !(value > 0 && value < max)) { return -1; }
+  *out = value;
+  return 0;
+}
+
+static int parse_modes(config_t* config, const char* list) {
+  char* copy = strdup(list);
+  char* saveptr = NULL;
+  config->modes = 0;
+
+  for (char* mode = strtok_r(copy, ",", &saveptr); mode != NULL; mode = strtok_r(NULL, ",", &saveptr)) {
+    if      (strcmp(mode, "complex") == 0)    { config->modes |= MODE_COMPLEX; }
+    else if (strcmp(mode, "simple") == 0)     { config->modes |= MODE_SIMPLE; }
+    else if (strcmp(mode, "barrier") == 0)    { config->modes |= MODE_BARRIER; }
+    else if (strcmp(mode, "throughput") == 0) { config->modes |= MODE_THROUGHPUT; }
+    else if (strcmp(mode, "pingpong") == 0)   { config->modes |= MODE_PINGPONG; }
+    else if (strcmp(mode, "stride") == 0)     { config->modes |= MODE_STRIDE; }
+    else if (strcmp(mode, "ordering") == 0)   { config->modes |= MODE_ORDERING; }
+    else if (strcmp(mode, "locks") == 0)      { config->modes |= MODE_LOCKS; }
+    else if (strcmp(mode, "counters") == 0)   { config->modes |= MODE_COUNTERS; }
+    else if (strcmp(mode, "combining") == 0)  { config->modes |= MODE_COMBINING; }
+    else if (strcmp(mode, "backoff") == 0)    { config->modes |= MODE_BACKOFF; }
+    else if (strcmp(mode, "window") == 0)     { config->modes |= MODE_WINDOW; }
+    else {
+      fprintf(stderr, "Unknown mode '%s'.\n", mode);
+      free(copy);
+      return -1;
+    }
+  }
+  free(copy);
+  return 0;
+}
+
+// Accepts START, START:STOP or START:STOP:STEP.
+static int parse_thread_range(config_t* config, const char* range) {
+  char* copy = strdup(range);
+  char* saveptr = NULL;
+  int* fields[] = { &config->thread_start, &config->thread_stop, &config->thread_step };
+  int parsed = 0;
+
+  for (char* field = strtok_r(copy, ":", &saveptr); field != NULL; field = strtok_r(NULL, ":", &saveptr)) {
+    if (parsed == 3 || parse_positive(field, fields[parsed]) != 0) {
+      free(copy);
+      return -1;
+    }
+    parsed += 1;
+  }
+  free(copy);
+
+  if (parsed == 0) { return -1; }
+  if (parsed == 1) { config->thread_stop = config->thread_start; }
+  return 0;
+}
+
+static int parse_strategies(config_t* config, const char* list) {
+  free(config->strategies);
+  config->strategies = calloc(increment_strategy_count, sizeof(*config->strategies));
+  config->strategy_count = 0;
+
+  if (strcmp(list, "all") == 0) {
+    for (int s = 0; s < increment_strategy_count; s++) {
+      config->strategies[config->strategy_count++] = &increment_strategies[s];
+    }
+    return 0;
+  }
+
+  char* copy = strdup(list);
+  char* saveptr = NULL;
+  for (char* name = strtok_r(copy, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+    const increment_strategy_t* strategy = find_strategy(name);
+    if (strategy == NULL) {
+      fprintf(stderr, "Unknown strategy '%s'.\n", name);
+      free(copy);
+      return -1;
+    }
+    if (config->strategy_count < increment_strategy_count) {
+      config->strategies[config->strategy_count++] = strategy;
+    }
+  }
+  free(copy);
+  return config->strategy_count > 0 ? 0 : -1;
+}
+
+static int parse_locks(config_t* config, const char* list) {
+  free(config->locks);
+  config->locks = calloc(lock_algorithm_count, sizeof(*config->locks));
+  config->lock_count = 0;
+
+  if (strcmp(list, "all") == 0) {
+    for (int l = 0; l < lock_algorithm_count; l++) {
+      config->locks[config->lock_count++] = &lock_algorithms[l];
+    }
+    return 0;
+  }
+
+  char* copy = strdup(list);
+  char* saveptr = NULL;
+  for (char* name = strtok_r(copy, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+    const lock_algorithm_t* lock = find_lock(name);
+    if (lock == NULL) {
+      fprintf(stderr, "Unknown lock '%s'.\n", name);
+      free(copy);
+      return -1;
+    }
+    if (config->lock_count < lock_algorithm_count) {
+      config->locks[config->lock_count++] = lock;
+    }
+  }
+  free(copy);
+  return config->lock_count > 0 ? 0 : -1;
+}
+
+// Accepts byte counts that are a multiple of 'sizeof(int)', "packed"
+// for adjacent ints and "page" for one page apart.
+static int parse_strides(config_t* config, const char* list) {
+  char* copy = strdup(list);
+  char* saveptr = NULL;
+  int capacity = 1;
+  for (const char* c = list; *c != '\0'; c++) { capacity += *c == ','; }
+
+  free(config->strides);
+  config->strides = calloc(capacity, sizeof(int));
+  config->stride_count = 0;
+
+  for (char* name = strtok_r(copy, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+    int stride;
+    if      (strcmp(name, "packed") == 0) { stride = sizeof(int); }
+    else if (strcmp(name, "page") == 0)   { stride = (int) sysconf(_SC_PAGESIZE); }
+    else if (parse_positive(name, &stride) != 0 || stride % sizeof(int) != 0 || stride > (1 << 20)) {
+      fprintf(stderr, "Invalid stride '%s'.\n", name);
+      free(copy);
+      return -1;
+    }
+    config->strides[config->stride_count++] = stride;
+  }
+  free(copy);
+  return config->stride_count > 0 ? 0 : -1;
+}
+
+// Accepts a raw event encoding in decimal, hex ("0x...") or octal.
+static int parse_raw_event(const char* text, unsigned long long* out) {
+  char* end;
+  errno = 0;
+  unsigned long long value = strtoull(text, &end, 0);
+  if (errno != 0 || end == text || *end != '\0' || value == 0) { return -1; }
+  *out = value;
+  return 0;
+}
+
+// Accepts delay lengths from 0 to 2^20.
+static int parse_windows(config_t* config, const char* list) {
+  char* copy = strdup(list);
+  char* saveptr = NULL;
+  int capacity = 1;
+  for (const char* c = list; *c != '\0'; c++) { capacity += *c == ','; }
+
+  free(config->windows);
+  config->windows = calloc(capacity, sizeof(int));
+  config->window_count = 0;
+
+  for (char* name = strtok_r(copy, ",", &saveptr); name != NULL; name = strtok_r(NULL, ",", &saveptr)) {
+    int length = 0;
+    if (strcmp(name, "0") != 0 && (parse_positive(name, &length) != 0 || length > (1 << 20))) {
+      fprintf(stderr, "Invalid window length '%s'.\n", name);
+      free(copy);
+      return -1;
+    }
+    config->windows[config->window_count++] = length;
+  }
+  free(copy);
+  return config->window_count > 0 ? 0 : -1;
+}
+
+static int parse_barrier(config_t* config, const char* name) {
+  config->barrier = find_barrier(name);
+  if (config->barrier != NULL) { return 0; }
+  fprintf(stderr, "Unknown barrier '%s'.\n", name);
+  return -1;
+}
+
+static int parse_format(config_t* config, const char* name) {
+  if (strcmp(name, "table") == 0) { config->format = FORMAT_TABLE; return 0; }
+  if (strcmp(name, "csv") == 0)   { config->format = FORMAT_CSV;   return 0; }
+  if (strcmp(name, "json") == 0)  { config->format = FORMAT_JSON;  return 0; }
+  fprintf(stderr, "Unknown output format '%s'.\n", name);
+  return -1;
+}
+
+// Expands the START:STOP:STEP range into 'thread_counts'.
+static int expand_thread_counts(config_t* config) {
+  if (config->thread_stop < config->thread_start) {
+    fprintf(stderr, "Thread range stops (%d) before it starts (%d).\n",
+            config->thread_stop, config->thread_start);
+    return -1;
+  }
+  if (config->thread_geometric && config->thread_step < 2) {
+    fprintf(stderr, "A geometric thread range needs a STEP of at least 2.\n");
+    return -1;
+  }
+
+  int capacity = config->thread_stop - config->thread_start + 1;
+  config->thread_counts = calloc(capacity, sizeof(int));
+  config->thread_count_len = 0;
+
+  for (long long t = config->thread_start; t <= config->thread_stop;
+       t = config->thread_geometric ? t * config->thread_step : t + config->thread_step) {
+    config->thread_counts[config->thread_count_len++] = (int) t;
+  }
+  config->max_threads = config->thread_counts[config->thread_count_len - 1];
+  return 0;
+}
+
+int parse_config(config_t* config, int argc, char** argv) {
+  enum { OPT_FORK_JOIN = 256, OPT_BARRIER_EPISODES, OPT_OUTPUT, OPT_STRIDES, OPT_ORDER, OPT_BARRIER_ORDER,
+         OPT_LOCKS, OPT_LOCK_MS, OPT_WINDOWS, OPT_PERF, OPT_HITM_EVENT,
+         OPT_CI_WIDTH, OPT_ROW_BUDGET, OPT_BUDGET };
+  static const struct option options[] = {
+    { "modes",            required_argument, NULL, 'm' },
+    { "threads",          required_argument, NULL, 't' },
+    { "geometric",        no_argument,       NULL, 'g' },
+    { "experiments",      required_argument, NULL, 'e' },
+    { "ci-width",         required_argument, NULL, OPT_CI_WIDTH },
+    { "row-budget",       required_argument, NULL, OPT_ROW_BUDGET },
+    { "budget",           required_argument, NULL, OPT_BUDGET },
+    { "ops",              required_argument, NULL, 'n' },
+    { "strategies",       required_argument, NULL, 's' },
+    { "strides",          required_argument, NULL, OPT_STRIDES },
+    { "windows",          required_argument, NULL, OPT_WINDOWS },
+    { "locks",            required_argument, NULL, OPT_LOCKS },
+    { "lock-ms",          required_argument, NULL, OPT_LOCK_MS },
+    { "barrier",          required_argument, NULL, 'b' },
+    { "barrier-episodes", required_argument, NULL, OPT_BARRIER_EPISODES },
+    { "order",            required_argument, NULL, OPT_ORDER },
+    { "barrier-order",    required_argument, NULL, OPT_BARRIER_ORDER },
+    { "perf",             no_argument,       NULL, OPT_PERF },
+    { "hitm-event",       required_argument, NULL, OPT_HITM_EVENT },
+    { "pin",              required_argument, NULL, 'p' },
+    { "format",           required_argument, NULL, 'o' },
+    { "output",           required_argument, NULL, OPT_OUTPUT },
+    { "fork-join",        no_argument,       NULL, OPT_FORK_JOIN },
+    { "help",             no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 },
+  };
+
+  *config = (config_t) {
+    .modes            = MODE_COMPLEX | MODE_SIMPLE,
+    .thread_start     = 1,
+    .thread_stop      = online_cpu_count(),
+    .thread_step      = 0,
+    .experiments      = DEFAULT_EXPERIMENTS,
+    .ops_per_thread   = DEFAULT_OPS_PER_THREAD,
+    .lock_ms          = DEFAULT_LOCK_MS,
+    .row_budget       = DEFAULT_ROW_BUDGET,
+    .barrier          = find_barrier("sense"),
+    .barrier_episodes = DEFAULT_BARRIER_EPISODES,
+    .increment_order  = ORDER_DEFAULT,
+    .barrier_order    = ORDER_DEFAULT,
+    .pin_policy       = PIN_ROUND_ROBIN,
+    .use_thread_pool  = true,
+    .format           = FORMAT_TABLE,
+  };
+  if (parse_strategies(config, "all") != 0) { return -1; }
+  if (parse_strides(config, "packed,64,128,page") != 0) { return -1; }
+  if (parse_windows(config, "0,1,4,16,64,256,1024") != 0) { return -1; }
+  if (parse_locks(config, "all") != 0) { return -1; }
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "m:t:ge:n:s:b:p:o:h", options, NULL)) != -1) {
+    int err = 0;
+    switch (opt) {
+      case 'm': err = parse_modes(config, optarg); break;
+      case 't': err = parse_thread_range(config, optarg); break;
+      case 'g': config->thread_geometric = true; break;
+      case 'e': err = parse_positive(optarg, &config->experiments); break;
+      case OPT_CI_WIDTH:   err = parse_below(optarg, 1, &config->ci_width); break;
+      case OPT_ROW_BUDGET: err = parse_below(optarg, 1e6, &config->row_budget); break;
+      case OPT_BUDGET:     err = parse_below(optarg, 1e6, &config->budget); break;
+      case 'n': err = parse_ops(optarg, &config->ops_per_thread); break;
+      case 's': err = parse_strategies(config, optarg); break;
+      case OPT_STRIDES: err = parse_strides(config, optarg); break;
+      case OPT_WINDOWS: err = parse_windows(config, optarg); break;
+      case OPT_LOCKS:   err = parse_locks(config, optarg); break;
+      case OPT_LOCK_MS: err = parse_positive(optarg, &config->lock_ms); break;
+      case 'b': err = parse_barrier(config, optarg); break;
+      case OPT_BARRIER_EPISODES: err = parse_positive(optarg, &config->barrier_episodes); break;
+      case OPT_ORDER:         err = parse_ordering(optarg, &config->increment_order); break;
+      case OPT_BARRIER_ORDER: err = parse_ordering(optarg, &config->barrier_order); break;
+      case OPT_PERF: config->perf_counters = true; break;
+      case OPT_HITM_EVENT:
+        err = parse_raw_event(optarg, &config->hitm_event);
+        config->perf_counters = true;
+        break;
+      case 'p': err = parse_pin_policy(optarg, &config->pin_policy); break;
+      case 'o': err = parse_format(config, optarg); break;
+      case OPT_OUTPUT: config->output_path = optarg; break;
+      case OPT_FORK_JOIN: config->use_thread_pool = false; break;
+      case 'h': usage(argv[0]); return 1;
+      default:  err = -1; break;
+    }
+    if (err != 0) {
+      // The list parsers name the offending entry themselves.
+      if (opt == 't' || opt == 'e' || opt == 'n' || opt == 'p') { fprintf(stderr, "Invalid argument for -%c: '%s'\n", opt, optarg); }
+      if (opt == OPT_BARRIER_EPISODES) { fprintf(stderr, "Invalid argument for --barrier-episodes: '%s'\n", optarg); }
+      if (opt == OPT_LOCK_MS)          { fprintf(stderr, "Invalid argument for --lock-ms: '%s'\n", optarg); }
+      if (opt == OPT_HITM_EVENT)       { fprintf(stderr, "Invalid argument for --hitm-event: '%s'\n", optarg); }
+      if (opt == OPT_CI_WIDTH)         { fprintf(stderr, "Invalid argument for --ci-width: '%s'\n", optarg); }
+      if (opt == OPT_ROW_BUDGET)       { fprintf(stderr, "Invalid argument for --row-budget: '%s'\n", optarg); }
+      if (opt == OPT_BUDGET)           { fprintf(stderr, "Invalid argument for --budget: '%s'\n", optarg); }
+      if (opt == OPT_ORDER)            { fprintf(stderr, "Unknown memory ordering '%s'.\n", optarg); }
+      if (opt == OPT_BARRIER_ORDER)    { fprintf(stderr, "Unknown memory ordering '%s'.\n", optarg); }
+      fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+      return -1;
+    }
+  }
+  if (optind < argc) {
+    fprintf(stderr, "Unexpected argument '%s'.\n", argv[optind]);
+    return -1;
+  }
+
+  if (config->output_path != NULL && config->format == FORMAT_TABLE) {
+    fprintf(stderr, "--output needs --format=csv or --format=json.\n");
+    return -1;
+  }
+
+  if (config->thread_step == 0) { config->thread_step = config->thread_geometric ? 2 : 1; }
+  return expand_thread_counts(config);
+}
+
+void free_config(config_t* config) {
+  free(config->thread_counts);
+  free(config->strategies);
+  free(config->strides);
+  free(config->windows);
+  free(config->locks);
+  config->thread_counts = NULL;
+  config->strategies = NULL;
+  config->strides = NULL;
+  config->windows = NULL;
+  config->locks = NULL;
+}
@@ -0,0 +1,105 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+
+#include "barrier.h"
+#include "locks.h"
+#include "ordering.h"
+#include "strategies.h"
+#include "topology.h"
+
+// Run-time Configuration -----------------------------------------
+//-----------------------------------------------------------------
+
+// Modes are a bit set so that several can run back to back.
+enum {
+  MODE_COMPLEX    = 1 << 0,
+  MODE_SIMPLE     = 1 << 1,
+  MODE_BARRIER    = 1 << 2,
+  MODE_THROUGHPUT = 1 << 3,
+  MODE_PINGPONG   = 1 << 4,
+  MODE_STRIDE     = 1 << 5,
+  MODE_ORDERING   = 1 << 6,
+  MODE_LOCKS      = 1 << 7,
+  MODE_COUNTERS   = 1 << 8,
+  MODE_COMBINING  = 1 << 9,
+  MODE_BACKOFF    = 1 << 10,
+  MODE_WINDOW     = 1 << 11,
+};
+
+typedef enum {
+  FORMAT_TABLE,
+  FORMAT_CSV,
+  FORMAT_JSON,
+} output_format_t;
+
+typedef struct {
+  unsigned modes;
+
+  // Thread counts to sweep, expanded from the START:STOP:STEP range.
+  int  thread_start;
+  int  thread_stop;
+  int  thread_step;
+  bool thread_geometric;     // Multiply by 'thread_step' instead of adding it.
+  int* thread_counts;
+  int  thread_count_len;
+  int  max_threads;          // Largest entry of 'thread_counts'.
+
+  int experiments;           // Experiments per (thread count, strategy).
+
+  // With 'ci_width' > 0 complex mode ignores 'experiments' and runs each
+  // row until the 95% confidence interval on its failure probability is
+  // at most 'ci_width' wide, or 'row_budget' seconds have gone by.
+  double ci_width;
+  double row_budget;
+
+  // With 'budget' > 0 complex mode instead shares 'budget' seconds out
+  // among all rows, always giving the next batch to the row whose
+  // interval is widest. 'ci_width', if set, still lets a row stop early.
+  double budget;
+  long long ops_per_thread;  // Increments per worker in throughput mode.
+
+  const increment_strategy_t** strategies;
+  int strategy_count;
+
+  // Byte distances between the per-worker counters in stride mode.
+  int* strides;
+  int  stride_count;
+
+  // Delay lengths between load and store in window mode.
+  int* windows;
+  int  window_count;
+
+  // Lock algorithms compared in lock mode, and how long each one runs
+  // at each thread count.
+  const lock_algorithm_t** locks;
+  int lock_count;
+  int lock_ms;
+
+  const barrier_algorithm_t* barrier;   // Start line for complex and simple mode.
+  int barrier_episodes;                 // Crossings per run in barrier mode.
+
+  // Memory ordering of the increment and of the start line. ORDER_DEFAULT
+  // keeps what each strategy and barrier was written with.
+  memory_ordering_t increment_order;
+  memory_ordering_t barrier_order;
+
+  // Hardware counters around the measured code ('--perf'), and the raw
+  // encoding of this CPU's HITM event, 0 for none.
+  bool               perf_counters;
+  unsigned long long hitm_event;
+
+  pin_policy_t    pin_policy;
+  bool            use_thread_pool;
+  output_format_t format;
+  const char*     output_path;   // Where the csv/json report goes; NULL is stdout.
+} config_t;
+
+// Fills 'config' from the command line. Returns 0 to run, 1 when the
+// program should exit successfully (e.g. after '--help') and -1 on a
+// usage error, in which case a message has already been printed.
+int  parse_config(config_t* config, int argc, char** argv);
+void free_config(config_t* config);
+
+#endif // CONFIG_H
@@ -0,0 +1,200 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "stats.h"
+#include "strategies.h"
+#include "timestamp.h"
+
+// Counter Read Mode ----------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Throughput mode shows what sharding buys the writers. This mode shows
+ * what it costs the reader. Worker 0 reads the counter over and over
+ * while the other workers each add 'config->ops_per_thread' to it, the
+ * way a monitoring thread samples a statistics counter in production.
+ *
+ *   Write Mops/s  increments per microsecond, with the reader running
+ *   Cells         cache lines the counter spans when the writers are done
+ *   Read          time for one read: a single load for 'atomic', a
+ *                 walk over every cell for the sharded counters
+ *   Window        increments that land while one read is in progress,
+ *                 i.e. write rate * mean read time. A read may include
+ *                 any subset of them, so this is how stale (or early)
+ *                 it can be. Zero for a single word, which is read at
+ *                 one instant.
+ *   Correct       the final read, after the writers are done, is exact
+ *
+ * Only counters that are safe to read while being written take part.
+ */
+
+static const char* const counter_names[] = { "atomic", "sharded", "percpu", "adaptive" };
+#define COUNTER_COUNT ((int) (sizeof(counter_names) / sizeof(counter_names[0])))
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t released;
+  uint64_t finished;
+} counter_stamps_t;
+
+static const increment_strategy_t* counter;
+static barrier_wait_fn_t start_line;
+static long long ops_per_thread;
+static int writer_count;
+static counter_stamps_t* stamps;
+
+static _Alignas(CACHE_LINE_SIZE) atomic_int writers_done;
+
+static long long read_count;
+static double read_total_ns;
+static log_histogram_t* read_ns;
+
+static void reader(void) {
+  // Keep reading until every writer is done, and at least once.
+  do {
+    uint64_t before = ticks_now();
+    volatile long long value = counter->read();
+    (void) value;
+    uint64_t after = ticks_now();
+
+    double ns = ticks_to_ns(after - before);
+    log_histogram_record(read_ns, (uint64_t) ns);
+    read_total_ns += ns;
+    read_count += 1;
+  } while (atomic_load_explicit(&writers_done, memory_order_acquire) < writer_count);
+}
+
+static void* counter_worker(void* id) {
+  int t = (intptr_t) id;
+  start_line(t);
+  stamps[t].released = ticks_now();
+
+  if (t == 0) {
+    reader();
+  } else {
+    for (long long op = 0; op < ops_per_thread; op++) { counter->increment(t); }
+    atomic_fetch_add_explicit(&writers_done, 1, memory_order_release);
+  }
+
+  stamps[t].finished = ticks_now();
+  return NULL;
+}
+
+typedef struct {
+  double write_mops;
+  double read_mean_ns;
+  double window;
+  int    cells;
+  bool   correct;
+} counter_result_t;
+
+static counter_result_t run_counter(const config_t* config, thread_pool_t* pool, int thread_count) {
+  counter_result_t result = { 0, 0, 0, 0, false };
+  if (barrier_arm(config->barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config->barrier->name, thread_count);
+    return result;
+  }
+
+  counter->reset();
+  writer_count = thread_count - 1;
+  atomic_store(&writers_done, 0);
+  read_count = 0;
+  read_total_ns = 0;
+  log_histogram_init(read_ns);
+  thread_pool_run(pool, thread_count, counter_worker);
+
+  uint64_t first_release = UINT64_MAX;
+  uint64_t last_finish = 0;
+  for (int t = 1; t < thread_count; t++) {
+    if (stamps[t].released < first_release) { first_release = stamps[t].released; }
+    if (stamps[t].finished > last_finish)   { last_finish = stamps[t].finished; }
+  }
+
+  long long total = ops_per_thread * writer_count;
+  double elapsed_ns = ticks_to_ns(last_finish - first_release);
+  result.write_mops = elapsed_ns > 0 ? total / elapsed_ns * 1e3 : 0;
+  result.read_mean_ns = read_total_ns / read_count;
+
+  // A single word is read at one instant; only multi-cell reads have a
+  // window for increments to slip into.
+  result.cells = strategy_footprint(counter);
+  result.window = result.cells == 1 ? 0 : result.write_mops * result.read_mean_ns / 1e3;
+
+  // The int based counters wrap long before 'total' does; as in
+  // throughput mode, compare those modulo 2^32. The wider ones must
+  // match exactly.
+  long long final = counter->read();
+  result.correct = counter->counter_bits == 32 ? (uint32_t) final == (uint32_t) total
+                                               : final == total;
+  return result;
+}
+
+void counter_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Counter Read Mode---------------------\n");
+  table_printf("|Counter  |  Writers | Cells |    Write Mops/s |      Reads | Read p50 (ns) | Read p99 (ns) | Window (ops) | Correct |\n");
+
+  if (config->max_threads < 2) {
+    table_printf("(needs at least 2 threads: one reader and one writer)\n");
+    return;
+  }
+
+  start_line = barrier_wait_fn(config->barrier, config->barrier_order);
+  ops_per_thread = config->ops_per_thread;
+  stamps = aligned_alloc(CACHE_LINE_SIZE, sizeof(counter_stamps_t) * config->max_threads);
+  read_ns = malloc(sizeof(log_histogram_t));
+  if (stamps == NULL || read_ns == NULL) {
+    fprintf(stderr, "Unable to allocate counter mode state.\n");
+    free(stamps);
+    free(read_ns);
+    stamps = NULL;
+    return;
+  }
+
+  for (int k = 0; k < COUNTER_COUNT; k++) {
+    counter = find_strategy(counter_names[k]);
+
+    for (int c = 0; c < config->thread_count_len; c++) {
+      int thread_count = config->thread_counts[c];
+      if (thread_count < 2) { continue; }
+
+      counter_result_t result = run_counter(config, pool, thread_count);
+      percentiles_t read = log_histogram_percentiles(read_ns);
+
+      table_printf("| %-8s| %8d | %5d | %15.2f | %10lld | %13.1f | %13.1f | %12.1f | %-7s |\n",
+                   counter->name,
+                   writer_count,
+                   result.cells,
+                   result.write_mops,
+                   read_count,
+                   read.p50,
+                   read.p99,
+                   result.window,
+                   result.correct ? "yes" : "NO");
+
+      report_field_t fields[] = {
+        REPORT_STRING("counter",        counter->name),
+        REPORT_INT   ("writers",        writer_count),
+        REPORT_INT   ("ops_per_thread", ops_per_thread),
+        REPORT_INT   ("cells",          result.cells),
+        REPORT_DOUBLE("write_mops",     result.write_mops),
+        REPORT_INT   ("reads",          read_count),
+        REPORT_DOUBLE("read_mean_ns",   result.read_mean_ns),
+        REPORT_PERCENTILES("read", read),
+        REPORT_DOUBLE("window_ops",     result.window),
+        REPORT_INT   ("correct",        result.correct),
+      };
+      report_row("counters", fields, sizeof(fields) / sizeof(fields[0]));
+    }
+  }
+
+  free(read_ns);
+  free(stamps);
+  read_ns = NULL;
+  stamps = NULL;
+}
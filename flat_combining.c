@@ -0,0 +1,74 @@
+#include <stdlib.h>
+
+#include "flat_combining.h"
+
+int flat_counter_init(flat_counter_t* counter, int max_threads) {
+  counter->slots = aligned_alloc(CACHE_LINE_SIZE, sizeof(combining_slot_t) * max_threads);
+  if (counter->slots == NULL) { return -1; }
+  counter->slot_count = max_threads;
+  atomic_store(&counter->lock, false);
+  flat_counter_reset(counter);
+  return 0;
+}
+
+void flat_counter_destroy(flat_counter_t* counter) {
+  free(counter->slots);
+  counter->slots = NULL;
+  counter->slot_count = 0;
+}
+
+// Applies every published request. Called with the lock held.
+static void combine(flat_counter_t* counter) {
+  long long sum = 0;
+  int served = 0;
+
+  for (int s = 0; s < counter->slot_count; s++) {
+    atomic_llong* pending = &counter->slots[s].pending;
+    long long delta = atomic_load_explicit(pending, memory_order_acquire);
+    if (delta == 0) { continue; }
+
+    sum += delta;
+    served += 1;
+    // Only the owner sets its slot and it waits for us to clear it, so
+    // a plain store cannot lose a request.
+    atomic_store_explicit(pending, 0, memory_order_release);
+  }
+
+  counter->value += sum;
+  counter->passes += 1;
+  counter->applied += served;
+}
+
+void flat_counter_add(flat_counter_t* counter, int thread_id, long long delta) {
+  atomic_llong* pending = &counter->slots[thread_id].pending;
+  atomic_store_explicit(pending, delta, memory_order_release);
+
+  unsigned spins = 0;
+  for (;;) {
+    if (atomic_load_explicit(pending, memory_order_acquire) == 0) { return; }
+
+    if (!atomic_load_explicit(&counter->lock, memory_order_relaxed) &&
+        !atomic_exchange_explicit(&counter->lock, true, memory_order_acquire)) {
+      // The previous combiner may have served us between our check and
+      // taking the lock; then there is nothing to pass over. Otherwise
+      // our request is still pending and this pass applies it.
+      if (atomic_load_explicit(pending, memory_order_acquire) != 0) { combine(counter); }
+      atomic_store_explicit(&counter->lock, false, memory_order_release);
+      return;
+    }
+    spin_pause(&spins);
+  }
+}
+
+long long flat_counter_read(const flat_counter_t* counter) { return counter->value; }
+
+void flat_counter_reset(flat_counter_t* counter) {
+  for (int s = 0; s < counter->slot_count; s++) { atomic_store(&counter->slots[s].pending, 0); }
+  counter->value = 0;
+  counter->passes = 0;
+  counter->applied = 0;
+}
+
+double flat_counter_degree(const flat_counter_t* counter) {
+  return counter->passes > 0 ? (double) counter->applied / counter->passes : 0;
+}
@@ -0,0 +1,60 @@
+#ifndef FLAT_COMBINING_H
+#define FLAT_COMBINING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "platform.h"
+
+// Flat-Combining Counter -----------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Hendler, Incze, Shavit and Tzafrir's flat combining, applied to a
+ * counter. Instead of every thread fighting for the counter's line, a
+ * thread writes its delta into a slot of its own and tries to take the
+ * combiner lock. Whoever gets it walks every slot, adds up the pending
+ * deltas, applies them to the counter in one go and clears the slots.
+ * Everyone else waits on their own slot until it is cleared, taking
+ * over as combiner if the lock comes free first.
+ *
+ * Under heavy contention one pass serves many threads, so the counter
+ * line and the lock move between cores once per pass rather than once
+ * per increment. Under light contention it is a lock plus a scan and
+ * loses to a single fetch-add. The combining degree, increments applied
+ * per pass, says which regime a run was in.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_llong pending;   // 0 when there is no request.
+} combining_slot_t;
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_bool lock;
+
+  // Only touched by the combiner.
+  _Alignas(CACHE_LINE_SIZE) long long value;
+  long long passes;
+  long long applied;
+
+  combining_slot_t* slots;
+  int slot_count;
+} flat_counter_t;
+
+// Allocates a slot for each of 'max_threads' thread ids. Returns 0 on
+// success.
+int  flat_counter_init(flat_counter_t* counter, int max_threads);
+void flat_counter_destroy(flat_counter_t* counter);
+
+// Adds 'delta', which must not be 0, on behalf of 'thread_id'. Returns
+// once a combiner, possibly the caller, has applied it.
+void flat_counter_add(flat_counter_t* counter, int thread_id, long long delta);
+
+// Only exact while nobody is adding.
+long long flat_counter_read(const flat_counter_t* counter);
+void      flat_counter_reset(flat_counter_t* counter);
+
+// Requests applied per combiner pass since the last reset.
+double flat_counter_degree(const flat_counter_t* counter);
+
+#endif // FLAT_COMBINING_H
@@ -0,0 +1,191 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "locks.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "stats.h"
+#include "timestamp.h"
+#include "topology.h"
+
+// Lock Mode ------------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The 'spinlock' strategy protects 'shared_data += 1' with one particular
+ * lock. This mode puts every algorithm from locks.h in its place and
+ * lets the workers fight over it for 'config->lock_ms' milliseconds at
+ * each thread count. Runs are timed rather than counted so that a lock
+ * which starves some workers shows it, instead of just taking longer.
+ *
+ *   Mops/s      critical sections per microsecond of run time
+ *   Acquire     time from asking for the lock to holding it
+ *   Fairness    Jain's index over per-worker acquisitions: 1.0 when
+ *               everyone got the same share, 1/N when one worker got all
+ *   Max/Min     most acquisitions by one worker over the fewest
+ *   Correct     'shared_data' equals the total acquisitions
+ *
+ * With more workers than online CPUs ('*' after the thread count) a
+ * spinning waiter can burn the time slice the holder needs, and queue
+ * locks can hand the lock to a waiter that is not even running. That
+ * is where the sleeping locks earn their keep.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t released;
+  uint64_t  finished;
+  long long acquisitions;
+  log_histogram_t acquire_ns;
+} lock_worker_t;
+
+static const lock_algorithm_t* algorithm;
+static barrier_wait_fn_t start_line;
+static uint64_t run_ticks;          // 'config->lock_ms' in ticks.
+static lock_worker_t* workers;
+
+static _Alignas(CACHE_LINE_SIZE) volatile long long shared_data;
+
+static void* lock_worker(void* id) {
+  int t = (intptr_t) id;
+  lock_worker_t* self = &workers[t];
+
+  start_line(t);
+  self->released = ticks_now();
+  uint64_t deadline = self->released + run_ticks;
+
+  // The stamp that starts each acquire doubles as the deadline check,
+  // so there is no shared stop flag for the workers to contend on.
+  for (uint64_t before = self->released; before < deadline; before = ticks_now()) {
+    algorithm->lock(t);
+    uint64_t acquired = ticks_now();
+    shared_data += 1;
+    algorithm->unlock(t);
+
+    self->acquisitions += 1;
+    log_histogram_record(&self->acquire_ns, (uint64_t) ticks_to_ns(acquired - before));
+  }
+
+  self->finished = ticks_now();
+  return NULL;
+}
+
+typedef struct {
+  long long     total;
+  double        mops;
+  percentiles_t acquire;
+  double        fairness;
+  double        max_min;     // 0 when some worker never got the lock.
+  bool          correct;
+} lock_result_t;
+
+static lock_result_t run_lock(const config_t* config, thread_pool_t* pool, int thread_count,
+                              log_histogram_t* merged) {
+  lock_result_t result = { 0 };
+  if (barrier_arm(config->barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config->barrier->name, thread_count);
+    return result;
+  }
+  if (algorithm->init(thread_count) != 0) {
+    fprintf(stderr, "Unable to set up lock '%s' for %d threads.\n", algorithm->name, thread_count);
+    return result;
+  }
+
+  shared_data = 0;
+  for (int t = 0; t < thread_count; t++) {
+    workers[t].acquisitions = 0;
+    log_histogram_init(&workers[t].acquire_ns);
+  }
+  thread_pool_run(pool, thread_count, lock_worker);
+  algorithm->destroy();
+
+  uint64_t first_release = UINT64_MAX;
+  uint64_t last_finish = 0;
+  long long fewest = workers[0].acquisitions;
+  long long most = 0;
+  double sum_squares = 0;
+  log_histogram_init(merged);
+  for (int t = 0; t < thread_count; t++) {
+    const lock_worker_t* worker = &workers[t];
+    if (worker->released < first_release) { first_release = worker->released; }
+    if (worker->finished > last_finish)   { last_finish = worker->finished; }
+    if (worker->acquisitions < fewest)    { fewest = worker->acquisitions; }
+    if (worker->acquisitions > most)      { most = worker->acquisitions; }
+    result.total += worker->acquisitions;
+    sum_squares += (double) worker->acquisitions * worker->acquisitions;
+    log_histogram_merge(merged, &worker->acquire_ns);
+  }
+
+  double elapsed_ns = ticks_to_ns(last_finish - first_release);
+  result.mops = elapsed_ns > 0 ? result.total / elapsed_ns * 1e3 : 0;
+  result.acquire = log_histogram_percentiles(merged);
+  result.fairness = sum_squares > 0 ? (double) result.total * result.total / (thread_count * sum_squares) : 0;
+  result.max_min = fewest > 0 ? (double) most / fewest : 0;
+  result.correct = shared_data == result.total;
+  return result;
+}
+
+void lock_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Lock Mode-----------------------------\n");
+  table_printf("|Lock             |Thread_Count |     Mops/s | p50 (ns) | p99 (ns) | p99.9 (ns) |   Max (ns) | Fairness | Max/Min | Correct |\n");
+
+  workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(lock_worker_t) * config->max_threads);
+  log_histogram_t* merged = malloc(sizeof(log_histogram_t));
+  if (workers == NULL || merged == NULL) {
+    fprintf(stderr, "Unable to allocate lock mode state.\n");
+    free(workers);
+    free(merged);
+    workers = NULL;
+    return;
+  }
+
+  start_line = barrier_wait_fn(config->barrier, config->barrier_order);
+  double ticks_per_ns = 1e6 / ticks_to_ns(1000000);
+  run_ticks = (uint64_t) (config->lock_ms * 1e6 * ticks_per_ns);
+  int online = online_cpu_count();
+
+  for (int l = 0; l < config->lock_count; l++) {
+    algorithm = config->locks[l];
+
+    for (int c = 0; c < config->thread_count_len; c++) {
+      int thread_count = config->thread_counts[c];
+      lock_result_t result = run_lock(config, pool, thread_count, merged);
+      bool oversubscribed = thread_count > online;
+
+      table_printf("| %-16s| %10d%c | %10.2f | %8.0f | %8.0f | %10.0f | %10.0f | %8.3f | %7.2f | %-7s |\n",
+                   algorithm->name,
+                   thread_count,
+                   oversubscribed ? '*' : ' ',
+                   result.mops,
+                   result.acquire.p50,
+                   result.acquire.p99,
+                   result.acquire.p999,
+                   result.acquire.max,
+                   result.fairness,
+                   result.max_min,
+                   result.correct ? "yes" : "NO");
+
+      report_field_t fields[] = {
+        REPORT_STRING("lock",           algorithm->name),
+        REPORT_INT   ("thread_count",   thread_count),
+        REPORT_INT   ("oversubscribed", oversubscribed),
+        REPORT_INT   ("duration_ms",    config->lock_ms),
+        REPORT_INT   ("acquisitions",   result.total),
+        REPORT_DOUBLE("mops",           result.mops),
+        REPORT_PERCENTILES("acquire", result.acquire),
+        REPORT_DOUBLE("fairness",       result.fairness),
+        REPORT_DOUBLE("max_min",        result.max_min),
+        REPORT_INT   ("correct",        result.correct),
+      };
+      report_row("locks", fields, sizeof(fields) / sizeof(fields[0]));
+    }
+  }
+  if (config->max_threads > online) { table_printf("(* more threads than online CPUs)\n"); }
+
+  free(merged);
+  free(workers);
+  workers = NULL;
+}
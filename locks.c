@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "locks.h"
+#include "platform.h"
+
+static void no_destroy(void) {}
+
+// Test-and-set ---------------------------------------------------
+//-----------------------------------------------------------------
+
+// Every waiter hammers the lock word with exchanges, so the line
+// ping-pongs between them even while the holder is busy.
+static _Alignas(CACHE_LINE_SIZE) atomic_bool tas_word;
+
+static int tas_init(int max_threads) {
+  atomic_store(&tas_word, false);
+  return 0;
+}
+
+static void tas_lock(int id) {
+  unsigned spins = 0;
+  while (atomic_exchange_explicit(&tas_word, true, memory_order_acquire)) { spin_pause(&spins); }
+}
+
+static void tas_unlock(int id) { atomic_store_explicit(&tas_word, false, memory_order_release); }
+
+// Test-and-test-and-set with backoff -----------------------------
+//-----------------------------------------------------------------
+
+// Waiters spin on a shared copy of the line and only exchange once the
+// lock looks free. Whoever loses that race waits an exponentially
+// growing while before trying again, which spreads out the stampede
+// that follows every release.
+#define TTAS_MIN_BACKOFF 4
+#define TTAS_MAX_BACKOFF 1024
+
+static _Alignas(CACHE_LINE_SIZE) atomic_bool ttas_word;
+
+static int ttas_init(int max_threads) {
+  atomic_store(&ttas_word, false);
+  return 0;
+}
+
+static void ttas_lock(int id) {
+  unsigned backoff = TTAS_MIN_BACKOFF;
+  for (;;) {
+    unsigned spins = 0;
+    while (atomic_load_explicit(&ttas_word, memory_order_relaxed)) { spin_pause(&spins); }
+    if (!atomic_exchange_explicit(&ttas_word, true, memory_order_acquire)) { return; }
+
+    for (unsigned i = 0; i < backoff; i++) { cpu_relax(); }
+    if (backoff < TTAS_MAX_BACKOFF) { backoff *= 2; }
+  }
+}
+
+static void ttas_unlock(int id) { atomic_store_explicit(&ttas_word, false, memory_order_release); }
+
+// Ticket ---------------------------------------------------------
+//-----------------------------------------------------------------
+
+// Two counters: the next ticket to hand out and the ticket being
+// served. Strictly first come, first served, but every waiter still
+// spins on 'now_serving', so each release invalidates all of them.
+static struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_uint next_ticket;
+  _Alignas(CACHE_LINE_SIZE) atomic_uint now_serving;
+} ticket;
+
+static int ticket_init(int max_threads) {
+  atomic_store(&ticket.next_ticket, 0);
+  atomic_store(&ticket.now_serving, 0);
+  return 0;
+}
+
+static void ticket_lock(int id) {
+  unsigned mine = atomic_fetch_add_explicit(&ticket.next_ticket, 1, memory_order_relaxed);
+  unsigned spins = 0;
+  while (atomic_load_explicit(&ticket.now_serving, memory_order_acquire) != mine) { spin_pause(&spins); }
+}
+
+static void ticket_unlock(int id) {
+  unsigned served = atomic_load_explicit(&ticket.now_serving, memory_order_relaxed);
+  atomic_store_explicit(&ticket.now_serving, served + 1, memory_order_release);
+}
+
+// Array-based queue ----------------------------------------------
+//-----------------------------------------------------------------
+
+// Anderson's lock: a ticket picks a slot in a ring of padded flags and
+// each waiter spins on its own slot. The holder hands over by setting
+// the next slot, so a release touches exactly one waiter's line. The
+// ring needs at least one slot per thread that may wait at once.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_bool has_lock;
+} array_slot_t;
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) unsigned slot;
+} array_local_t;
+
+static _Alignas(CACHE_LINE_SIZE) atomic_uint array_tail;
+static array_slot_t* array_slots;
+static array_local_t* array_local;
+static unsigned array_size;
+
+static void array_destroy(void);
+
+static int array_init(int max_threads) {
+  // The ticket counter wraps at 2^32, so the ring size has to divide
+  // that for 'ticket % array_size' to keep going round in order.
+  unsigned size = 1;
+  while (size < (unsigned) max_threads) { size *= 2; }
+
+  array_slots = alloc_lines(size, sizeof(array_slot_t));
+  array_local = alloc_lines(max_threads, sizeof(array_local_t));
+  if (array_slots == NULL || array_local == NULL) {
+    array_destroy();
+    return -1;
+  }
+  array_size = size;
+  atomic_store(&array_tail, 0);
+  atomic_store(&array_slots[0].has_lock, true);
+  return 0;
+}
+
+static void array_lock(int id) {
+  unsigned slot = atomic_fetch_add_explicit(&array_tail, 1, memory_order_relaxed) % array_size;
+  array_local[id].slot = slot;
+
+  unsigned spins = 0;
+  while (!atomic_load_explicit(&array_slots[slot].has_lock, memory_order_acquire)) { spin_pause(&spins); }
+}
+
+static void array_unlock(int id) {
+  unsigned slot = array_local[id].slot;
+  atomic_store_explicit(&array_slots[slot].has_lock, false, memory_order_relaxed);
+  atomic_store_explicit(&array_slots[(slot + 1) % array_size].has_lock, true, memory_order_release);
+}
+
+static void array_destroy(void) {
+  free(array_slots);
+  free(array_local);
+  array_slots = NULL;
+  array_local = NULL;
+}
+
+// MCS ------------------------------------------------------------
+//-----------------------------------------------------------------
+
+// Waiters form an explicit linked list. Each one swaps itself in as the
+// tail, links itself behind its predecessor and spins on a flag in its
+// own node until the predecessor hands the lock over.
+typedef struct mcs_node {
+  _Alignas(CACHE_LINE_SIZE) _Atomic(struct mcs_node*) next;
+  atomic_bool locked;
+} mcs_node_t;
+
+static _Alignas(CACHE_LINE_SIZE) _Atomic(mcs_node_t*) mcs_tail;
+static mcs_node_t* mcs_nodes;
+
+static int mcs_init(int max_threads) {
+  mcs_nodes = alloc_lines(max_threads, sizeof(mcs_node_t));
+  if (mcs_nodes == NULL) { return -1; }
+  atomic_store(&mcs_tail, NULL);
+  return 0;
+}
+
+static void mcs_lock(int id) {
+  mcs_node_t* self = &mcs_nodes[id];
+  atomic_store_explicit(&self->next, NULL, memory_order_relaxed);
+  atomic_store_explicit(&self->locked, true, memory_order_relaxed);
+
+  mcs_node_t* predecessor = atomic_exchange_explicit(&mcs_tail, self, memory_order_acq_rel);
+  if (predecessor == NULL) { return; }
+
+  atomic_store_explicit(&predecessor->next, self, memory_order_release);
+  unsigned spins = 0;
+  while (atomic_load_explicit(&self->locked, memory_order_acquire)) { spin_pause(&spins); }
+}
+
+static void mcs_unlock(int id) {
+  mcs_node_t* self = &mcs_nodes[id];
+  mcs_node_t* successor = atomic_load_explicit(&self->next, memory_order_acquire);
+
+  if (successor == NULL) {
+    // Nobody queued behind us, unless someone is between swapping the
+    // tail and linking in. Then wait for the link.
+    mcs_node_t* expected = self;
+    if (atomic_compare_exchange_strong_explicit(&mcs_tail, &expected, NULL,
+                                                memory_order_release, memory_order_relaxed)) {
+      return;
+    }
+    unsigned spins = 0;
+    while ((successor = atomic_load_explicit(&self->next, memory_order_acquire)) == NULL) { spin_pause(&spins); }
+  }
+  atomic_store_explicit(&successor->locked, false, memory_order_release);
+}
+
+static void mcs_destroy(void) {
+  free(mcs_nodes);
+  mcs_nodes = NULL;
+}
+
+// CLH ------------------------------------------------------------
+//-----------------------------------------------------------------
+
+// The queue is implicit: each waiter swaps its node into the tail and
+// spins on the node it got back. On release a thread clears its own
+// node and adopts its predecessor's, which nobody else is watching any
+// more. Needs one node more than there are threads.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_bool locked;
+} clh_node_t;
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) clh_node_t* node;
+  clh_node_t* predecessor;
+} clh_local_t;
+
+static _Alignas(CACHE_LINE_SIZE) _Atomic(clh_node_t*) clh_tail;
+static clh_node_t* clh_nodes;
+static clh_local_t* clh_local;
+
+static void clh_destroy(void);
+
+static int clh_init(int max_threads) {
+  clh_nodes = alloc_lines(max_threads + 1, sizeof(clh_node_t));
+  clh_local = alloc_lines(max_threads, sizeof(clh_local_t));
+  if (clh_nodes == NULL || clh_local == NULL) {
+    clh_destroy();
+    return -1;
+  }
+  for (int t = 0; t < max_threads; t++) { clh_local[t].node = &clh_nodes[t + 1]; }
+  atomic_store(&clh_tail, &clh_nodes[0]);
+  return 0;
+}
+
+static void clh_lock(int id) {
+  clh_local_t* self = &clh_local[id];
+  atomic_store_explicit(&self->node->locked, true, memory_order_relaxed);
+  self->predecessor = atomic_exchange_explicit(&clh_tail, self->node, memory_order_acq_rel);
+
+  unsigned spins = 0;
+  while (atomic_load_explicit(&self->predecessor->locked, memory_order_acquire)) { spin_pause(&spins); }
+}
+
+static void clh_unlock(int id) {
+  clh_local_t* self = &clh_local[id];
+  atomic_store_explicit(&self->node->locked, false, memory_order_release);
+  self->node = self->predecessor;
+}
+
+static void clh_destroy(void) {
+  free(clh_nodes);
+  free(clh_local);
+  clh_nodes = NULL;
+  clh_local = NULL;
+}
+
+// pthread_mutex --------------------------------------------------
+//-----------------------------------------------------------------
+
+// glibc's default mutex sleeps in the kernel as soon as it is taken.
+// The adaptive kind spins for a while first, betting that the holder
+// is running on another core and about to let go.
+static pthread_mutex_t posix_mutex;
+
+static int posix_init_kind(int kind) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, kind);
+  int err = pthread_mutex_init(&posix_mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+  return err == 0 ? 0 : -1;
+}
+
+static int posix_init(int max_threads) { return posix_init_kind(PTHREAD_MUTEX_NORMAL); }
+
+// Only offered where the C library has adaptive mutexes; a normal mutex
+// under this name would just repeat the 'pthread' row.
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+static int posix_adaptive_init(int max_threads) { return posix_init_kind(PTHREAD_MUTEX_ADAPTIVE_NP); }
+#endif
+
+static void posix_lock(int id)    { pthread_mutex_lock(&posix_mutex); }
+static void posix_unlock(int id)  { pthread_mutex_unlock(&posix_mutex); }
+static void posix_destroy(void)   { pthread_mutex_destroy(&posix_mutex); }
+
+// Futex mutex ----------------------------------------------------
+//-----------------------------------------------------------------
+
+// Drepper's "Futexes Are Tricky" mutex. The word is 0 when unlocked, 1
+// when locked and 2 when locked with possible sleepers. An uncontended
+// lock and unlock is one RMW each and never enters the kernel; only an
+// unlock that finds 2 pays for a wake.
+static _Alignas(CACHE_LINE_SIZE) atomic_uint futex_word;
+
+static int futex_mutex_init(int max_threads) {
+  atomic_store(&futex_word, 0);
+  return 0;
+}
+
+static void futex_mutex_lock(int id) {
+  unsigned state = 0;
+  if (atomic_compare_exchange_strong_explicit(&futex_word, &state, 1, memory_order_acquire, memory_order_relaxed)) {
+    return;
+  }
+  if (state != 2) { state = atomic_exchange_explicit(&futex_word, 2, memory_order_acquire); }
+  while (state != 0) {
+    futex_wait(&futex_word, 2);
+    state = atomic_exchange_explicit(&futex_word, 2, memory_order_acquire);
+  }
+}
+
+static void futex_mutex_unlock(int id) {
+  if (atomic_fetch_sub_explicit(&futex_word, 1, memory_order_release) != 1) {
+    atomic_store_explicit(&futex_word, 0, memory_order_release);
+    futex_wake(&futex_word, 1);
+  }
+}
+
+// Lock Table -----------------------------------------------------
+//-----------------------------------------------------------------
+
+const lock_algorithm_t lock_algorithms[] = {
+  { "tas",              "exchange on one word",                     tas_init,            tas_lock,         tas_unlock,         no_destroy    },
+  { "ttas",             "read until free, exchange, backoff",       ttas_init,           ttas_lock,        ttas_unlock,        no_destroy    },
+  { "ticket",           "ticket counter, FIFO",                     ticket_init,         ticket_lock,      ticket_unlock,      no_destroy    },
+  { "array",            "Anderson array queue, padded slots",       array_init,          array_lock,       array_unlock,       array_destroy },
+  { "mcs",              "MCS list queue, spin on own node",         mcs_init,            mcs_lock,         mcs_unlock,         mcs_destroy   },
+  { "clh",              "CLH implicit queue, spin on predecessor",  clh_init,            clh_lock,         clh_unlock,         clh_destroy   },
+  { "pthread",          "pthread_mutex_t, normal",                  posix_init,          posix_lock,       posix_unlock,       posix_destroy },
+#ifdef PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP
+  { "pthread-adaptive", "pthread_mutex_t, adaptive spin",           posix_adaptive_init, posix_lock,       posix_unlock,       posix_destroy },
+#endif
+  { "futex",            "three-state futex mutex",                  futex_mutex_init,    futex_mutex_lock, futex_mutex_unlock, no_destroy    },
+};
+
+const int lock_algorithm_count = sizeof(lock_algorithms) / sizeof(lock_algorithms[0]);
+
+const lock_algorithm_t* find_lock(const char* name) {
+  for (int l = 0; l < lock_algorithm_count; l++) {
+    if (strcmp(lock_algorithms[l].name, name) == 0) { return &lock_algorithms[l]; }
+  }
+  return NULL;
+}
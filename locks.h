@@ -0,0 +1,43 @@
+#ifndef LOCKS_H
+#define LOCKS_H
+
+// Lock Algorithms ------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Mutual exclusion around 'shared_data += 1', from the simplest spin
+ * on one word to queue locks where every waiter spins on a line of its
+ * own:
+ *
+ *   tas               exchange until it returns "free"
+ *   ttas              read until free, then exchange; back off on failure
+ *   ticket            take a number, wait until it is served; FIFO
+ *   array             Anderson's queue: one padded slot per waiter
+ *   mcs               linked queue; each waiter spins on its own node
+ *   clh               implicit queue; each waiter spins on its predecessor
+ *   pthread           pthread_mutex_t, PTHREAD_MUTEX_NORMAL
+ *   pthread-adaptive  PTHREAD_MUTEX_ADAPTIVE_NP: spins briefly first (glibc only)
+ *   futex             three-state futex mutex (unlocked, locked, contended)
+ *
+ * Like the barriers, every lock keeps its state in file-level statics
+ * and only one can be in use at a time. Callers identify themselves by
+ * their worker index, 0..max_threads-1.
+ */
+
+typedef struct {
+  const char* name;
+  const char* description;
+
+  int  (*init)(int max_threads);   // Returns 0 on success, cleaning up on failure.
+  void (*lock)(int id);
+  void (*unlock)(int id);
+  void (*destroy)(void);
+} lock_algorithm_t;
+
+extern const lock_algorithm_t lock_algorithms[];
+extern const int lock_algorithm_count;
+
+// Returns the lock called 'name' or NULL if there is none.
+const lock_algorithm_t* find_lock(const char* name);
+
+#endif // LOCKS_H
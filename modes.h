@@ -0,0 +1,54 @@
+#ifndef MODES_H
+#define MODES_H
+
+#include "config.h"
+#include "thread_pool.h"
+
+// Benchmark Modes ------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Complex and simple mode live with the worker in
+ * shared_mutable_access.c. The modes below each measure one piece of
+ * the machinery around the increment in isolation. Those taking a
+ * pool run on it; it holds 'config->max_threads' workers. The others
+ * start and pin their own threads.
+ */
+
+// Episode latency and release skew of every barrier algorithm.
+void barrier_mode(const config_t* config, thread_pool_t* pool);
+
+// Contended-counter throughput of every strategy over the thread sweep.
+void throughput_mode(const config_t* config, thread_pool_t* pool);
+
+// Throughput and lost updates of the atomic strategies at every memory
+// ordering of the increment and the start line.
+void ordering_mode(const config_t* config, thread_pool_t* pool);
+
+// Flat combining against fetch-add at each thread count, and where
+// combining starts to win.
+void combining_mode(const config_t* config, thread_pool_t* pool);
+
+// CAS failure ratio, retries and throughput under each retry backoff
+// policy.
+void backoff_mode(const config_t* config, thread_pool_t* pool);
+
+// Lost-update probability of a load, delay, store increment against
+// the width of the delay.
+void window_mode(const config_t* config, thread_pool_t* pool);
+
+// Throughput of private counters packed at each of 'config->strides'.
+void stride_mode(const config_t* config, thread_pool_t* pool);
+
+// Throughput, acquire latency and fairness of each of 'config->locks'
+// guarding a plain increment.
+void lock_mode(const config_t* config, thread_pool_t* pool);
+
+// Read cost and staleness of the sharded counters against one atomic,
+// with worker 0 reading while the others write.
+void counter_mode(const config_t* config, thread_pool_t* pool);
+
+// Cache line round-trip latency between every pair of allowed CPUs.
+void pingpong_mode(const config_t* config);
+
+#endif // MODES_H
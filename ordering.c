@@ -0,0 +1,28 @@
+#include <string.h>
+
+#include "ordering.h"
+
+static const char* ordering_names[ORDER_COUNT] = {
+  [ORDER_RELAXED]         = "relaxed",
+  [ORDER_ACQUIRE_RELEASE] = "acquire-release",
+  [ORDER_ACQ_REL]         = "acq_rel",
+  [ORDER_SEQ_CST]         = "seq_cst",
+};
+
+int parse_ordering(const char* name, memory_ordering_t* ordering) {
+  if (strcmp(name, "default") == 0) {
+    *ordering = ORDER_DEFAULT;
+    return 0;
+  }
+  for (int o = 0; o < ORDER_COUNT; o++) {
+    if (strcmp(ordering_names[o], name) == 0) {
+      *ordering = (memory_ordering_t) o;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char* ordering_name(memory_ordering_t ordering) {
+  return ordering == ORDER_DEFAULT ? "default" : ordering_names[ordering];
+}
@@ -0,0 +1,75 @@
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#include <stdatomic.h>
+
+// Memory Ordering ------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Every atomic in the harness was written with the ordering its author
+ * thought it needed: seq_cst where nobody thought about it, acquire and
+ * release where somebody did. The levels below let a run override that
+ * for the counter and for the start line and see what it costs and
+ * whether anything breaks.
+ *
+ * An operation plays one of three roles, and each level picks a C11
+ * order for each role:
+ *
+ *                    acquire (loads,    release (stores,   both (RMWs that
+ *                    lock RMWs)         unlock)            observe and publish)
+ *   relaxed          relaxed            relaxed            relaxed
+ *   acquire-release  acquire            release            release
+ *   acq_rel          acquire            release            acq_rel
+ *   seq_cst          seq_cst            seq_cst            seq_cst
+ *
+ * On x86 every RMW is a full barrier whatever it is asked for, so only
+ * seq_cst stores differ (they become 'xchg'). On aarch64 each level
+ * picks different instructions.
+ */
+
+typedef enum {
+  ORDER_DEFAULT = -1,   // Whatever the code was written with.
+  ORDER_RELAXED,
+  ORDER_ACQUIRE_RELEASE,
+  ORDER_ACQ_REL,
+  ORDER_SEQ_CST,
+  ORDER_COUNT,
+} memory_ordering_t;
+
+#define ORDER_ACQUIRE(o) ((o) == ORDER_RELAXED ? memory_order_relaxed : \
+                          (o) == ORDER_SEQ_CST ? memory_order_seq_cst : memory_order_acquire)
+#define ORDER_RELEASE(o) ((o) == ORDER_RELAXED ? memory_order_relaxed : \
+                          (o) == ORDER_SEQ_CST ? memory_order_seq_cst : memory_order_release)
+#define ORDER_BOTH(o)    ((o) == ORDER_RELAXED         ? memory_order_relaxed : \
+                          (o) == ORDER_ACQUIRE_RELEASE ? memory_order_release : \
+                          (o) == ORDER_ACQ_REL         ? memory_order_acq_rel : memory_order_seq_cst)
+
+// A failed compare-exchange is only a load and may not be stronger than
+// the success order.
+#define ORDER_CAS_FAILURE(o) ((o) == ORDER_ACQ_REL ? memory_order_acquire : \
+                              (o) == ORDER_SEQ_CST ? memory_order_seq_cst : memory_order_relaxed)
+
+/*
+ * The compiler only honours a memory order it can see as a constant;
+ * anything else is quietly treated as seq_cst. So ordered code is
+ * written once as an always-inline 'NAME_ordered(int, memory_ordering_t)'
+ * and this macro stamps out one wrapper per level, with the level as a
+ * constant, plus the table 'NAME_by_order' indexed by level.
+ */
+#define ORDER_INLINE static inline __attribute__((always_inline))
+
+#define ORDERED_VARIANTS(name)                                                                   \
+  static void name##_relaxed(int id)         { name##_ordered(id, ORDER_RELAXED); }             \
+  static void name##_acquire_release(int id) { name##_ordered(id, ORDER_ACQUIRE_RELEASE); }     \
+  static void name##_acq_rel(int id)         { name##_ordered(id, ORDER_ACQ_REL); }             \
+  static void name##_seq_cst(int id)         { name##_ordered(id, ORDER_SEQ_CST); }             \
+  static void (*const name##_by_order[ORDER_COUNT])(int) = {                                     \
+    name##_relaxed, name##_acquire_release, name##_acq_rel, name##_seq_cst,                      \
+  };
+
+// Parses "default" or a level name. Returns 0 on success.
+int parse_ordering(const char* name, memory_ordering_t* ordering);
+const char* ordering_name(memory_ordering_t ordering);
+
+#endif // ORDERING_H
@@ -0,0 +1,222 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+#include "platform.h"
+
+static const char* event_names[PERF_EVENT_COUNT] = {
+  [PERF_CYCLES]       = "cycles",
+  [PERF_INSTRUCTIONS] = "instructions",
+  [PERF_L1D_MISSES]   = "l1d_misses",
+  [PERF_LLC_MISSES]   = "llc_misses",
+  [PERF_HITM]         = "hitm",
+};
+
+// One worker's group. 'pages' are the per-event pages the kernel keeps
+// up to date for 'rdpmc'; NULL where mapping failed.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) int fds[PERF_EVENT_COUNT];
+  struct perf_event_mmap_page* pages[PERF_EVENT_COUNT];
+} perf_group_t;
+
+static perf_group_t* groups;
+static int group_count;
+static bool available[PERF_EVENT_COUNT];
+static uint64_t hitm_raw;
+static long page_size;
+
+// The group this thread opened, so that a fresh fork-join thread can
+// tell it has to open its own.
+static _Thread_local perf_group_t* opened_group;
+
+static void describe_event(perf_event_t event, struct perf_event_attr* attr) {
+  memset(attr, 0, sizeof(*attr));
+  attr->size = sizeof(*attr);
+  attr->exclude_kernel = 1;
+  attr->exclude_hv = 1;
+
+  switch (event) {
+    case PERF_CYCLES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_L1D_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_L1D |
+                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case PERF_LLC_MISSES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PERF_HITM:
+      attr->type = PERF_TYPE_RAW;
+      attr->config = hitm_raw;
+      break;
+    default:
+      break;
+  }
+}
+
+static int open_event(perf_event_t event, int group_fd) {
+  struct perf_event_attr attr;
+  describe_event(event, &attr);
+  if (group_fd == -1) { attr.pinned = 1; }   // Leader: always on the PMU or in error.
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+static void close_group(perf_group_t* group) {
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+    if (group->pages[e] != NULL) { munmap(group->pages[e], page_size); }
+    if (group->fds[e] >= 0)      { close(group->fds[e]); }
+    group->pages[e] = NULL;
+    group->fds[e] = -1;
+  }
+}
+
+// Opens the group on the calling thread. Events that were available
+// when probed but fail now are simply left at -1.
+static void open_group(perf_group_t* group) {
+  int leader = -1;
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+    if (!available[e]) { continue; }
+    group->fds[e] = open_event((perf_event_t) e, leader);
+    if (group->fds[e] < 0) { continue; }
+    if (leader == -1) { leader = group->fds[e]; }
+
+    void* page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, group->fds[e], 0);
+    group->pages[e] = page == MAP_FAILED ? NULL : page;
+  }
+}
+
+int perf_counters_init(int max_workers, uint64_t hitm_config) {
+  hitm_raw = hitm_config;
+  page_size = sysconf(_SC_PAGESIZE);
+
+  // Probe on this thread: the leader first, then each member on its own
+  // behind it, so one refused event does not cost the rest.
+  int leader = open_event(PERF_CYCLES, -1);
+  if (leader < 0) {
+    fprintf(stderr, "Hardware counters unavailable (perf_event_open: %s); running without them.\n",
+            strerror(errno));
+    return -1;
+  }
+  available[PERF_CYCLES] = true;
+  for (int e = PERF_CYCLES + 1; e < PERF_EVENT_COUNT; e++) {
+    if (e == PERF_HITM && hitm_raw == 0) { continue; }
+    int fd = open_event((perf_event_t) e, leader);
+    available[e] = fd >= 0;
+    if (fd >= 0) { close(fd); }
+    else         { fprintf(stderr, "Counter '%s' unavailable: %s.\n", event_names[e], strerror(errno)); }
+  }
+  close(leader);
+
+  groups = aligned_alloc(CACHE_LINE_SIZE, sizeof(perf_group_t) * max_workers);
+  if (groups == NULL) { return -1; }
+  group_count = max_workers;
+  for (int g = 0; g < group_count; g++) {
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+      groups[g].fds[e] = -1;
+      groups[g].pages[e] = NULL;
+    }
+  }
+  return 0;
+}
+
+void perf_counters_cleanup(void) {
+  for (int g = 0; g < group_count; g++) { close_group(&groups[g]); }
+  free(groups);
+  groups = NULL;
+  group_count = 0;
+}
+
+bool perf_event_available(perf_event_t event) { return available[event]; }
+const char* perf_event_name(perf_event_t event) { return event_names[event]; }
+
+// The self-monitoring read from include/uapi/linux/perf_event.h: retry
+// until the kernel did not update the page underneath us. Returns false
+// if the counter is not on the PMU right now and has to be read().
+static bool read_mapped(volatile struct perf_event_mmap_page* page, uint64_t* value) {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t sequence;
+  uint64_t count;
+  do {
+    sequence = page->lock;
+    atomic_signal_fence(memory_order_seq_cst);
+    uint32_t index = page->index;
+    if (!page->cap_user_rdpmc || index == 0) { return false; }
+
+    int64_t pmc = (int64_t) __builtin_ia32_rdpmc(index - 1);
+    pmc <<= 64 - page->pmc_width;
+    pmc >>= 64 - page->pmc_width;
+    count = page->offset + pmc;
+    atomic_signal_fence(memory_order_seq_cst);
+  } while (page->lock != sequence);
+  *value = count;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void perf_counters_attach(int worker) {
+  perf_group_t* group = &groups[worker];
+  if (opened_group == group) { return; }
+
+  // A new thread for this worker, or this thread serving a new worker.
+  close_group(group);
+  open_group(group);
+  opened_group = group;
+}
+
+void perf_counters_read(int worker, perf_sample_t* sample) {
+  const perf_group_t* group = &groups[worker];
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+    sample->value[e] = 0;
+    if (group->fds[e] < 0) { continue; }
+    if (group->pages[e] != NULL && read_mapped(group->pages[e], &sample->value[e])) { continue; }
+    if (read(group->fds[e], &sample->value[e], sizeof(uint64_t)) != sizeof(uint64_t)) { sample->value[e] = 0; }
+  }
+}
+
+void perf_sample_accumulate(perf_sample_t* total, const perf_sample_t* before, const perf_sample_t* after) {
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) { total->value[e] += after->value[e] - before->value[e]; }
+}
+
+void perf_print_header(void) {
+  table_printf("     Cycles |  Instrs | L1D Miss | LLC Miss |     HITM |");
+}
+
+void perf_print_values(const perf_sample_t* total, double per) {
+  static const int widths[PERF_EVENT_COUNT]    = { 10, 7, 8, 8, 8 };
+  static const int precision[PERF_EVENT_COUNT] = { 1, 1, 3, 3, 3 };
+
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+    if (available[e]) { table_printf(" %*.*f |", widths[e], precision[e], per > 0 ? total->value[e] / per : 0.0); }
+    else              { table_printf(" %*s |", widths[e], "-"); }
+  }
+}
+
+int perf_report_fields(const perf_sample_t* total, double per, report_field_t* fields) {
+  static const char* keys[PERF_EVENT_COUNT] = {
+    "cycles_per_op", "instructions_per_op", "l1d_misses_per_op", "llc_misses_per_op", "hitm_per_op",
+  };
+  int count = 0;
+  for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+    if (!available[e]) { continue; }
+    fields[count++] = REPORT_DOUBLE(keys[e], per > 0 ? total->value[e] / per : 0.0);
+  }
+  return count;
+}
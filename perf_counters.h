@@ -0,0 +1,84 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "report.h"
+
+// Hardware Performance Counters ----------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * With '--perf' every worker opens one perf_event_open group on itself
+ * and reads it around the code under test, so the tables can say how
+ * many cycles, instructions and cache misses the increment really
+ * cost. The group is scheduled onto the PMU as a unit, so the counts
+ * in one sample come from the same stretch of time.
+ *
+ *   cycles        core clock cycles, user space only
+ *   instructions  instructions retired
+ *   l1d_misses    L1 data cache read misses
+ *   llc_misses    last level cache misses (the generic hardware event)
+ *   hitm          loads that hit a line Modified in another core's
+ *                 cache: the signature of a contended counter. There
+ *                 is no generic event for it, so it is only counted
+ *                 when '--hitm-event' gives the raw encoding for this
+ *                 CPU (e.g. 0x04d2, MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM
+ *                 on Skylake).
+ *
+ * Reads go through 'rdpmc' on the page the kernel maps for each event,
+ * which costs tens of cycles rather than a system call, so they can sit
+ * right next to a three-instruction increment. Where 'rdpmc' is not
+ * allowed they fall back to 'read'.
+ *
+ * Any event the kernel or PMU refuses is left out and shown as '-'. If
+ * not even cycles can be counted (no PMU in the VM, perf_event_paranoid
+ * too strict) the run goes on without counters.
+ */
+
+typedef enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_HITM,
+  PERF_EVENT_COUNT,
+} perf_event_t;
+
+typedef struct {
+  uint64_t value[PERF_EVENT_COUNT];
+} perf_sample_t;
+
+// Checks which events can be counted and prepares a group slot for
+// each of 'max_workers' workers. 'hitm_config' is the raw encoding of
+// the HITM event, 0 for none. Returns 0 if at least cycles can be
+// counted; otherwise prints why and returns -1.
+int  perf_counters_init(int max_workers, uint64_t hitm_config);
+void perf_counters_cleanup(void);
+
+bool        perf_event_available(perf_event_t event);
+const char* perf_event_name(perf_event_t event);
+
+// Opens the group of worker 'worker' on the calling thread, unless this
+// thread already has it open. Costs system calls the first time, so
+// call it before the measured region.
+void perf_counters_attach(int worker);
+
+// Reads every counter of worker 'worker', which must be attached on the
+// calling thread, into 'sample'. Unavailable events read as 0.
+void perf_counters_read(int worker, perf_sample_t* sample);
+
+// total += after - before, event by event.
+void perf_sample_accumulate(perf_sample_t* total, const perf_sample_t* before, const perf_sample_t* after);
+
+// Table columns for every event, each value divided by 'per'.
+void perf_print_header(void);
+void perf_print_values(const perf_sample_t* total, double per);
+
+// Appends "<event>_per_op" for every available event to 'fields', each
+// value divided by 'per'. 'fields' needs room for PERF_EVENT_COUNT
+// entries. Returns the number appended.
+int perf_report_fields(const perf_sample_t* total, double per, report_field_t* fields);
+
+#endif // PERF_COUNTERS_H
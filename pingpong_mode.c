@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "timestamp.h"
+#include "topology.h"
+
+// Core-to-Core Ping-Pong Mode ------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Every lost update is a cache line that moved between two cores at the
+ * wrong moment. This mode measures what one such move costs for every
+ * pair of allowed CPUs. Two threads, pinned to the pair, take turns
+ * bumping a single 'atomic_int': the pinger writes an odd value and
+ * waits for the next even one, the ponger waits for the odd value and
+ * writes the even one. Each round trip moves the line there and back.
+ *
+ * The pinger is the calling thread, which gets its original affinity
+ * back when the mode is done. Round trips are timed in batches; the
+ * reported latency is the median batch divided by its size, which
+ * shrugs off the odd interrupt. The matrix is symmetric, so each pair
+ * is measured once and mirrored.
+ */
+
+#define PINGPONG_BATCHES 21
+#define PINGPONG_ROUNDS  500   // Round trips per batch.
+
+// The ball and the start line each get a line of their own, so the
+// only thing bouncing is the ball.
+static struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_int ball;
+  _Alignas(CACHE_LINE_SIZE) atomic_int arrived;
+} table;
+
+static int ping_cpu;
+static int pong_cpu;
+static double batch_ns[PINGPONG_BATCHES];
+
+// Both players pin themselves and then wait for each other, so the
+// first batch does not time the other thread's start-up.
+static void enter_table(int cpu) {
+  pin_current_thread(cpu);
+  atomic_fetch_add_explicit(&table.arrived, 1, memory_order_acq_rel);
+  unsigned spins = 0;
+  while (atomic_load_explicit(&table.arrived, memory_order_acquire) < 2) { spin_pause(&spins); }
+}
+
+static void wait_for_ball(int value) {
+  unsigned spins = 0;
+  while (atomic_load_explicit(&table.ball, memory_order_acquire) != value) { spin_pause(&spins); }
+}
+
+static void ping(void) {
+  enter_table(ping_cpu);
+  int value = 0;
+  for (int b = 0; b < PINGPONG_BATCHES; b++) {
+    uint64_t start = ticks_now();
+    for (int r = 0; r < PINGPONG_ROUNDS; r++) {
+      atomic_store_explicit(&table.ball, ++value, memory_order_release);
+      wait_for_ball(++value);
+    }
+    batch_ns[b] = ticks_to_ns(ticks_now() - start);
+  }
+}
+
+static void* pong(void* unused) {
+  enter_table(pong_cpu);
+  int value = 0;
+  for (int r = 0; r < PINGPONG_BATCHES * PINGPONG_ROUNDS; r++) {
+    wait_for_ball(++value);
+    atomic_store_explicit(&table.ball, ++value, memory_order_release);
+  }
+  return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*) a;
+  double y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+// Round-trip latency between two CPUs in nanoseconds, or -1 if the
+// ponger could not be started.
+static double measure_pair(int a, int b) {
+  ping_cpu = a;
+  pong_cpu = b;
+  atomic_store(&table.ball, 0);
+  atomic_store(&table.arrived, 0);
+
+  pthread_t ponger;
+  if (pthread_create(&ponger, NULL, pong, NULL) != 0) { return -1; }
+  ping();
+  pthread_join(ponger, NULL);
+
+  qsort(batch_ns, PINGPONG_BATCHES, sizeof(double), compare_doubles);
+  return batch_ns[PINGPONG_BATCHES / 2] / PINGPONG_ROUNDS;
+}
+
+// Darker is slower; the ramp spans the fastest to the slowest pair.
+static const char heat_ramp[] = " .:-=+*#%@";
+
+static void print_heatmap(const int* cpus, int count, const double* latency) {
+  double low = -1, high = 0;
+  for (int i = 0; i < count * count; i++) {
+    if (latency[i] < 0 || i / count == i % count) { continue; }
+    if (low < 0 || latency[i] < low) { low = latency[i]; }
+    if (latency[i] > high)           { high = latency[i]; }
+  }
+
+  int levels = sizeof(heat_ramp) - 2;
+  table_printf("\n");
+  table_printf("Heatmap ('%c' %.0f ns .. '%c' %.0f ns)\n", heat_ramp[0], low, heat_ramp[levels], high);
+  for (int a = 0; a < count; a++) {
+    table_printf("%4d |", cpus[a]);
+    for (int b = 0; b < count; b++) {
+      double ns = latency[a * count + b];
+      int level = high > low ? (int) ((ns - low) / (high - low) * levels + 0.5) : 0;
+      table_printf("%c", a == b ? '\\' : ns < 0 ? '?' : heat_ramp[level]);
+    }
+    table_printf("|\n");
+  }
+}
+
+void pingpong_mode(const config_t* config) {
+  table_printf("\n");
+  table_printf("Ping-Pong Mode------------------------\n");
+
+  int* cpus = calloc(CPU_SETSIZE, sizeof(int));
+  int count = cpus != NULL ? allowed_cpus(cpus, CPU_SETSIZE) : 0;
+  double* latency = calloc((size_t) count * count, sizeof(double));
+  if (count < 2 || latency == NULL) {
+    table_printf("Needs at least two allowed CPUs.\n");
+    free(cpus);
+    free(latency);
+    return;
+  }
+
+  cpu_set_t original;
+  sched_getaffinity(0, sizeof(original), &original);
+
+  for (int a = 0; a < count; a++) {
+    for (int b = a + 1; b < count; b++) {
+      double ns = measure_pair(cpus[a], cpus[b]);
+      latency[a * count + b] = ns;
+      latency[b * count + a] = ns;
+
+      report_field_t fields[] = {
+        REPORT_INT   ("cpu_a",         cpus[a]),
+        REPORT_INT   ("cpu_b",         cpus[b]),
+        REPORT_INT   ("round_trips",   PINGPONG_BATCHES * PINGPONG_ROUNDS),
+        REPORT_DOUBLE("round_trip_ns", ns),
+      };
+      report_row("pingpong", fields, sizeof(fields) / sizeof(fields[0]));
+    }
+  }
+
+  sched_setaffinity(0, sizeof(original), &original);
+
+  // The matrix itself is CSV: a header of CPUs, then one row per CPU.
+  table_printf("Round-trip latency (ns)\n");
+  table_printf("cpu");
+  for (int b = 0; b < count; b++) { table_printf(",%d", cpus[b]); }
+  table_printf("\n");
+  for (int a = 0; a < count; a++) {
+    table_printf("%d", cpus[a]);
+    for (int b = 0; b < count; b++) {
+      if (a == b) { table_printf(","); }
+      else        { table_printf(",%.1f", latency[a * count + b]); }
+    }
+    table_printf("\n");
+  }
+  print_heatmap(cpus, count, latency);
+
+  free(cpus);
+  free(latency);
+}
@@ -0,0 +1,76 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Low level helpers shared by the labs ---------------------------
+//-----------------------------------------------------------------
+
+// Size of a cache line on every machine we care about. Anything that
+// is written by one thread and spun on by another gets its own line
+// so that it does not drag unrelated data through the coherence
+// protocol.
+#define CACHE_LINE_SIZE 64
+
+// Hint to the processor that we are in a spin-wait loop. On x86 this
+// is 'pause' which de-pipelines the loop and lets an SMT sibling run;
+// on aarch64 'yield' serves the same purpose.
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+// Number of relax-spins a waiter does before it starts yielding its
+// CPU. Spinning keeps the wake-up latency low when every thread has a
+// core to itself; yielding keeps oversubscribed runs from crawling
+// while a waiter burns the time slice of the thread it is waiting on.
+#define SPIN_LIMIT 4096
+
+// One iteration of a spin-wait loop. 'spins' is the caller's count of
+// iterations so far and should start at zero.
+static inline void spin_pause(unsigned* spins) {
+  if (++*spins < SPIN_LIMIT) { cpu_relax(); }
+  else                       { sched_yield(); }
+}
+
+// Sleeps while '*word == expected'. May return spuriously; callers
+// re-check their condition in a loop.
+static inline void futex_wait(atomic_uint* word, unsigned expected) {
+  syscall(SYS_futex, (uint32_t*) word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+// Wakes up to 'count' threads sleeping on 'word'.
+static inline void futex_wake(atomic_uint* word, int count) {
+  syscall(SYS_futex, (uint32_t*) word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+// Monotonic wall clock in nanoseconds.
+static inline long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Allocates 'count' cache-line aligned, zeroed elements of 'size' bytes,
+// so that per-thread state in an array never shares a line.
+static inline void* alloc_lines(int count, size_t size) {
+  void* memory = aligned_alloc(CACHE_LINE_SIZE, size * count);
+  if (memory != NULL) { memset(memory, 0, size * count); }
+  return memory;
+}
+
+#endif // PLATFORM_H
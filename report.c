@@ -0,0 +1,399 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "report.h"
+#include "topology.h"
+
+// The build passes its flags in; see CMakeLists.txt.
+#ifndef BUILD_FLAGS
+#define BUILD_FLAGS "unknown"
+#endif
+
+#if defined(__clang__)
+#define COMPILER_NAME "clang"
+#elif defined(__GNUC__)
+#define COMPILER_NAME "gcc"
+#else
+#define COMPILER_NAME "unknown"
+#endif
+
+// Host Metadata --------------------------------------------------
+//-----------------------------------------------------------------
+
+typedef struct {
+  char cpu_model[256];
+  int  online_cpus;
+  int  configured_cpus;
+  char kernel[256];
+  char hostname[128];
+  char started[32];    // UTC, ISO 8601.
+} host_info_t;
+
+// "model name" on x86. Other architectures name the field differently,
+// so fall back to the first of a few alternatives that exists.
+static void read_cpu_model(char* model, size_t size) {
+  static const char* keys[] = { "model name", "Model", "cpu model", "Hardware" };
+  snprintf(model, size, "unknown");
+
+  FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+  if (cpuinfo == NULL) { return; }
+
+  char line[512];
+  int best = sizeof(keys) / sizeof(keys[0]);
+  while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+    char* colon = strchr(line, ':');
+    if (colon == NULL) { continue; }
+    for (int k = 0; k < best; k++) {
+      if (strncmp(line, keys[k], strlen(keys[k])) != 0) { continue; }
+      char* value = colon + 1;
+      while (*value == ' ' || *value == '\t') { value++; }
+      value[strcspn(value, "\n")] = '\0';
+      snprintf(model, size, "%s", value);
+      best = k;
+      break;
+    }
+    if (best == 0) { break; }
+  }
+  fclose(cpuinfo);
+}
+
+static void gather_host_info(host_info_t* host) {
+  read_cpu_model(host->cpu_model, sizeof(host->cpu_model));
+  host->online_cpus = online_cpu_count();
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  host->configured_cpus = configured > 0 ? (int) configured : host->online_cpus;
+
+  struct utsname name;
+  if (uname(&name) == 0) {
+    snprintf(host->kernel, sizeof(host->kernel), "%s %s %s", name.sysname, name.release, name.machine);
+    snprintf(host->hostname, sizeof(host->hostname), "%s", name.nodename);
+  } else {
+    snprintf(host->kernel, sizeof(host->kernel), "unknown");
+    snprintf(host->hostname, sizeof(host->hostname), "unknown");
+  }
+
+  time_t now = time(NULL);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  strftime(host->started, sizeof(host->started), "%Y-%m-%dT%H:%M:%SZ", &utc);
+}
+
+// Emitters -------------------------------------------------------
+//-----------------------------------------------------------------
+
+typedef struct {
+  const char* name;
+  void (*begin)(FILE* out, const report_field_t* host, int host_count,
+                const report_field_t* config, int config_count);
+  void (*row)(FILE* out, const report_field_t* fields, int count, bool new_columns);
+  void (*end)(FILE* out);
+} report_emitter_t;
+
+static FILE* out;
+static bool owns_stdout;
+static bool first_row;
+static const report_emitter_t* emitter;
+static char last_mode[32];
+
+// Doubles keep enough digits to round-trip a nanosecond count.
+static void print_double(FILE* file, double value) {
+  fprintf(file, "%.10g", value);
+}
+
+// CSV quotes a value only when it has to, doubling embedded quotes.
+static void csv_string(FILE* file, const char* text) {
+  if (strpbrk(text, ",\"\n") == NULL) { fputs(text, file); return; }
+  fputc('"', file);
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"') { fputc('"', file); }
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+static void csv_value(FILE* file, const report_field_t* field) {
+  switch (field->type) {
+    case FIELD_STRING: csv_string(file, field->string); break;
+    case FIELD_INT:    fprintf(file, "%lld", field->integer); break;
+    case FIELD_DOUBLE: if (isfinite(field->real)) { print_double(file, field->real); } break;
+  }
+}
+
+// Comment lines are not CSV, so their strings go out unquoted.
+static void csv_comment(FILE* file, const char* section, const report_field_t* field) {
+  fprintf(file, "# %s.%s: ", section, field->key);
+  if (field->type == FIELD_STRING) { fputs(field->string, file); }
+  else                             { csv_value(file, field); }
+  fputc('\n', file);
+}
+
+static void csv_begin(FILE* file, const report_field_t* host, int host_count,
+                      const report_field_t* config, int config_count) {
+  for (int f = 0; f < host_count; f++)   { csv_comment(file, "host", &host[f]); }
+  for (int f = 0; f < config_count; f++) { csv_comment(file, "config", &config[f]); }
+}
+
+static void csv_row(FILE* file, const report_field_t* fields, int count, bool new_columns) {
+  if (new_columns) {
+    fputc('\n', file);
+    for (int f = 0; f < count; f++) { fprintf(file, "%s%s", f > 0 ? "," : "", fields[f].key); }
+    fputc('\n', file);
+  }
+  for (int f = 0; f < count; f++) {
+    if (f > 0) { fputc(',', file); }
+    csv_value(file, &fields[f]);
+  }
+  fputc('\n', file);
+}
+
+static void csv_end(FILE* file) {}
+
+static void json_string(FILE* file, const char* text) {
+  fputc('"', file);
+  for (const unsigned char* c = (const unsigned char*) text; *c != '\0'; c++) {
+    if      (*c == '"' || *c == '\\') { fprintf(file, "\\%c", *c); }
+    else if (*c < 0x20)               { fprintf(file, "\\u%04x", *c); }
+    else                              { fputc(*c, file); }
+  }
+  fputc('"', file);
+}
+
+// JSON has no NaN or infinity; they become null.
+static void json_object(FILE* file, const report_field_t* fields, int count) {
+  fputc('{', file);
+  for (int f = 0; f < count; f++) {
+    if (f > 0) { fputs(", ", file); }
+    json_string(file, fields[f].key);
+    fputs(": ", file);
+    switch (fields[f].type) {
+      case FIELD_STRING: json_string(file, fields[f].string); break;
+      case FIELD_INT:    fprintf(file, "%lld", fields[f].integer); break;
+      case FIELD_DOUBLE:
+        if (isfinite(fields[f].real)) { print_double(file, fields[f].real); }
+        else                          { fputs("null", file); }
+        break;
+    }
+  }
+  fputc('}', file);
+}
+
+static void json_begin(FILE* file, const report_field_t* host, int host_count,
+                       const report_field_t* config, int config_count) {
+  fputs("{\n  \"host\": ", file);
+  json_object(file, host, host_count);
+  fputs(",\n  \"config\": ", file);
+  json_object(file, config, config_count);
+  fputs(",\n  \"results\": [", file);
+}
+
+static void json_row(FILE* file, const report_field_t* fields, int count, bool new_columns) {
+  fputs(first_row ? "\n    " : ",\n    ", file);
+  json_object(file, fields, count);
+}
+
+static void json_end(FILE* file) {
+  fputs("\n  ]\n}\n", file);
+}
+
+static const report_emitter_t emitters[] = {
+  [FORMAT_CSV]  = { "csv",  csv_begin,  csv_row,  csv_end  },
+  [FORMAT_JSON] = { "json", json_begin, json_row, json_end },
+};
+
+// Report ---------------------------------------------------------
+//-----------------------------------------------------------------
+
+static const config_t* report_config;
+
+// Every mode in the order main runs them, for the "modes" field.
+static const struct {
+  int mode;
+  const char* name;
+} mode_names[] = {
+  { MODE_COMPLEX,    "complex" },
+  { MODE_SIMPLE,     "simple" },
+  { MODE_BARRIER,    "barrier" },
+  { MODE_THROUGHPUT, "throughput" },
+  { MODE_PINGPONG,   "pingpong" },
+  { MODE_STRIDE,     "stride" },
+  { MODE_ORDERING,   "ordering" },
+  { MODE_LOCKS,      "locks" },
+  { MODE_COUNTERS,   "counters" },
+  { MODE_COMBINING,  "combining" },
+  { MODE_BACKOFF,    "backoff" },
+  { MODE_WINDOW,     "window" },
+};
+
+#define MODE_NAME_COUNT ((int) (sizeof(mode_names) / sizeof(mode_names[0])))
+
+// Joins 'count' strings with commas into a string the caller frees. The
+// first pass only measures, so the list is never cut short.
+static char* join_names(const char* const* names, int count) {
+  size_t length = 0;
+  for (int n = 0; n < count; n++) { length += strlen(names[n]) + (n > 0); }
+
+  char* buffer = malloc(length + 1);
+  if (buffer == NULL) { return NULL; }
+  size_t used = 0;
+  buffer[0] = '\0';
+  for (int n = 0; n < count; n++) {
+    int written = snprintf(buffer + used, length + 1 - used, "%s%s", n > 0 ? "," : "", names[n]);
+    if (written < 0 || (size_t) written >= length + 1 - used) { break; }
+    used += written;
+  }
+  return buffer;
+}
+
+// join_names for numbers, e.g. "1,2,4,8".
+static char* join_ints(const int* values, int count) {
+  size_t length = 0;
+  for (int n = 0; n < count; n++) { length += snprintf(NULL, 0, "%s%d", n > 0 ? "," : "", values[n]); }
+
+  char* buffer = malloc(length + 1);
+  if (buffer == NULL) { return NULL; }
+  size_t used = 0;
+  buffer[0] = '\0';
+  for (int n = 0; n < count; n++) {
+    int written = snprintf(buffer + used, length + 1 - used, "%s%d", n > 0 ? "," : "", values[n]);
+    if (written < 0 || (size_t) written >= length + 1 - used) { break; }
+    used += written;
+  }
+  return buffer;
+}
+
+int report_open(const config_t* config) {
+  report_config = config;
+  if (config->format == FORMAT_TABLE) { return 0; }
+
+  out = stdout;
+  if (config->output_path != NULL) {
+    out = fopen(config->output_path, "w");
+    if (out == NULL) {
+      perror(config->output_path);
+      return -1;
+    }
+  }
+  owns_stdout = out == stdout;
+  emitter = &emitters[config->format];
+  first_row = true;
+  last_mode[0] = '\0';
+
+  host_info_t host;
+  gather_host_info(&host);
+  report_field_t host_fields[] = {
+    REPORT_STRING("cpu_model",       host.cpu_model),
+    REPORT_INT   ("online_cpus",     host.online_cpus),
+    REPORT_INT   ("configured_cpus", host.configured_cpus),
+    REPORT_STRING("kernel",          host.kernel),
+    REPORT_STRING("hostname",        host.hostname),
+    REPORT_STRING("compiler",        COMPILER_NAME " " __VERSION__),
+    REPORT_STRING("flags",           BUILD_FLAGS),
+    REPORT_STRING("started",         host.started),
+  };
+
+  const char* modes[MODE_NAME_COUNT];
+  int mode_count = 0;
+  for (int m = 0; m < MODE_NAME_COUNT; m++) {
+    if (config->modes & mode_names[m].mode) { modes[mode_count++] = mode_names[m].name; }
+  }
+  char* mode_list = join_names(modes, mode_count);
+
+  const char** names = calloc(config->strategy_count, sizeof(*names));
+  for (int s = 0; s < config->strategy_count; s++) { names[s] = config->strategies[s]->name; }
+  char* strategy_list = join_names(names, config->strategy_count);
+  free(names);
+
+  names = calloc(config->lock_count, sizeof(*names));
+  for (int l = 0; l < config->lock_count; l++) { names[l] = config->locks[l]->name; }
+  char* lock_list = join_names(names, config->lock_count);
+  free(names);
+
+  char* thread_list = join_ints(config->thread_counts, config->thread_count_len);
+  char* stride_list = join_ints(config->strides, config->stride_count);
+  char* window_list = join_ints(config->windows, config->window_count);
+
+  report_field_t config_fields[] = {
+    REPORT_STRING("modes",            mode_list != NULL ? mode_list : ""),
+    REPORT_STRING("thread_counts",    thread_list != NULL ? thread_list : ""),
+    REPORT_INT   ("experiments",      config->experiments),
+    REPORT_DOUBLE("ci_width",         config->ci_width),
+    REPORT_DOUBLE("row_budget",       config->row_budget),
+    REPORT_DOUBLE("budget",           config->budget),
+    REPORT_INT   ("ops_per_thread",   config->ops_per_thread),
+    REPORT_STRING("strategies",       strategy_list != NULL ? strategy_list : ""),
+    REPORT_STRING("strides",          stride_list != NULL ? stride_list : ""),
+    REPORT_STRING("windows",          window_list != NULL ? window_list : ""),
+    REPORT_STRING("locks",            lock_list != NULL ? lock_list : ""),
+    REPORT_INT   ("lock_ms",          config->lock_ms),
+    REPORT_STRING("barrier",          config->barrier->name),
+    REPORT_INT   ("barrier_episodes", config->barrier_episodes),
+    REPORT_STRING("increment_order",  ordering_name(config->increment_order)),
+    REPORT_STRING("barrier_order",    ordering_name(config->barrier_order)),
+    REPORT_INT   ("perf",             config->perf_counters),
+    REPORT_INT   ("hitm_event",       (long long) config->hitm_event),
+    REPORT_STRING("pin",              pin_policy_name(config->pin_policy)),
+    REPORT_STRING("launch",           config->use_thread_pool ? "pool" : "fork-join"),
+    REPORT_STRING("format",           emitter->name),
+  };
+
+  emitter->begin(out,
+                 host_fields, sizeof(host_fields) / sizeof(host_fields[0]),
+                 config_fields, sizeof(config_fields) / sizeof(config_fields[0]));
+  free(mode_list);
+  free(strategy_list);
+  free(lock_list);
+  free(thread_list);
+  free(stride_list);
+  free(window_list);
+  return 0;
+}
+
+void report_close(void) {
+  if (emitter == NULL) { return; }
+  emitter->end(out);
+  if (out != stdout) { fclose(out); }
+  else               { fflush(out); }
+  emitter = NULL;
+  out = NULL;
+  owns_stdout = false;
+}
+
+#define REPORT_COMMON_FIELDS 6
+#define REPORT_MAX_FIELDS    64
+
+void report_row(const char* mode, const report_field_t* fields, int count) {
+  if (emitter == NULL) { return; }
+
+  report_field_t row[REPORT_MAX_FIELDS];
+  const config_t* config = report_config;
+  row[0] = REPORT_STRING("mode",            mode);
+  row[1] = REPORT_STRING("pin",             pin_policy_name(config->pin_policy));
+  row[2] = REPORT_STRING("launch",          config->use_thread_pool ? "pool" : "fork-join");
+  row[3] = REPORT_STRING("start_line",      config->barrier->name);
+  row[4] = REPORT_STRING("increment_order", ordering_name(config->increment_order));
+  row[5] = REPORT_STRING("barrier_order",   ordering_name(config->barrier_order));
+
+  if (count > REPORT_MAX_FIELDS - REPORT_COMMON_FIELDS) { count = REPORT_MAX_FIELDS - REPORT_COMMON_FIELDS; }
+  memcpy(&row[REPORT_COMMON_FIELDS], fields, count * sizeof(report_field_t));
+
+  bool new_columns = strcmp(mode, last_mode) != 0;
+  snprintf(last_mode, sizeof(last_mode), "%s", mode);
+
+  emitter->row(out, row, REPORT_COMMON_FIELDS + count, new_columns);
+  first_row = false;
+}
+
+void table_printf(const char* format, ...) {
+  if (owns_stdout) { return; }
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+}
@@ -0,0 +1,77 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include "config.h"
+#include "stats.h"
+
+// Machine-Readable Reports ---------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The tables are for people. With '--format=csv' or '--format=json'
+ * every mode also hands each of its rows to the report, which writes it
+ * out as a record that a script can ingest without scraping columns.
+ * The report opens with the host (CPU model, core count, kernel,
+ * compiler and flags) and the full configuration, so a file on its own
+ * is enough to tell which run produced it.
+ *
+ * Every record starts with the same columns: the mode that produced it,
+ * the pin policy, the launch path, the start-line barrier and the two
+ * memory orderings. The mode supplies the rest.
+ *
+ *   csv   '#'-prefixed "key: value" lines for host and configuration,
+ *         then a header line and records. A new header (after a blank
+ *         line) starts whenever the mode, and so the columns, change.
+ *   json  one object: "host", "config" and a "results" array holding
+ *         one object per record.
+ *
+ * The report goes to '--output' when given. The tables then still go
+ * to stdout, so nothing is lost. Without '--output' the report takes
+ * over stdout and the tables are dropped to keep the stream parseable.
+ */
+
+typedef enum {
+  FIELD_STRING,
+  FIELD_INT,
+  FIELD_DOUBLE,
+} report_field_type_t;
+
+// One named value of a record. Build them with the macros below.
+typedef struct {
+  const char* key;
+  report_field_type_t type;
+  union {
+    const char* string;
+    long long   integer;
+    double      real;
+  };
+} report_field_t;
+
+#define REPORT_STRING(k, v) ((report_field_t) { .key = (k), .type = FIELD_STRING, .string = (v) })
+#define REPORT_INT(k, v)    ((report_field_t) { .key = (k), .type = FIELD_INT, .integer = (v) })
+#define REPORT_DOUBLE(k, v) ((report_field_t) { .key = (k), .type = FIELD_DOUBLE, .real = (v) })
+
+// The five fields of a 'percentiles_t', named "<prefix>_p50_ns" and so
+// on. 'prefix' must be a string literal.
+#define REPORT_PERCENTILES(prefix, p)             \
+  REPORT_DOUBLE(prefix "_p50_ns",  (p).p50),      \
+  REPORT_DOUBLE(prefix "_p90_ns",  (p).p90),      \
+  REPORT_DOUBLE(prefix "_p99_ns",  (p).p99),      \
+  REPORT_DOUBLE(prefix "_p999_ns", (p).p999),     \
+  REPORT_DOUBLE(prefix "_max_ns",  (p).max)
+
+// Starts the report chosen by 'config->format' and writes the host and
+// configuration. Does nothing for the table format. Returns 0 on
+// success; -1 if '--output' cannot be opened.
+int  report_open(const config_t* config);
+void report_close(void);
+
+// Writes one record. Rows from the same mode must always carry the same
+// keys in the same order.
+void report_row(const char* mode, const report_field_t* fields, int count);
+
+// 'printf' for the human-readable tables. Drops the text while the
+// report owns stdout.
+void table_printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif // REPORT_H
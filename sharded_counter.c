@@ -0,0 +1,53 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sharded_counter.h"
+
+int sharded_counter_init(sharded_counter_t* counter, shard_index_t index, int max_threads) {
+  int cell_count = max_threads;
+  if (index == SHARD_BY_CPU) {
+    long configured = sysconf(_SC_NPROCESSORS_CONF);
+    cell_count = configured > 0 ? (int) configured : 1;
+  }
+
+  counter->cells = aligned_alloc(CACHE_LINE_SIZE, sizeof(counter_cell_t) * cell_count);
+  if (counter->cells == NULL) { return -1; }
+  counter->cell_count = cell_count;
+  counter->index = index;
+  sharded_counter_reset(counter);
+  return 0;
+}
+
+void sharded_counter_destroy(sharded_counter_t* counter) {
+  free(counter->cells);
+  counter->cells = NULL;
+  counter->cell_count = 0;
+}
+
+void sharded_counter_add(sharded_counter_t* counter, int thread_id, long long delta) {
+  if (counter->index == SHARD_BY_THREAD) {
+    // Nobody else writes this cell, so there is nothing to be atomic
+    // against; the atomic type only keeps concurrent reads well defined.
+    atomic_llong* cell = &counter->cells[thread_id].value;
+    atomic_store_explicit(cell, atomic_load_explicit(cell, memory_order_relaxed) + delta, memory_order_relaxed);
+    return;
+  }
+
+  int cpu = sched_getcpu();
+  int slot = cpu >= 0 ? cpu % counter->cell_count : thread_id % counter->cell_count;
+  atomic_fetch_add_explicit(&counter->cells[slot].value, delta, memory_order_relaxed);
+}
+
+long long sharded_counter_read(const sharded_counter_t* counter) {
+  long long total = 0;
+  for (int c = 0; c < counter->cell_count; c++) {
+    total += atomic_load_explicit(&counter->cells[c].value, memory_order_relaxed);
+  }
+  return total;
+}
+
+void sharded_counter_reset(sharded_counter_t* counter) {
+  for (int c = 0; c < counter->cell_count; c++) { atomic_store(&counter->cells[c].value, 0); }
+}
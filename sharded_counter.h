@@ -0,0 +1,62 @@
+#ifndef SHARDED_COUNTER_H
+#define SHARDED_COUNTER_H
+
+#include <stdatomic.h>
+
+#include "platform.h"
+
+// Sharded Counter ------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * A counter split into cells, one cache line each, so that writers on
+ * different cores never touch the same line. Adding is cheap and
+ * scales; reading has to visit every cell and sum them. That is the
+ * right trade for statistics counters, which are bumped on every hot
+ * path and read by a monitoring thread once in a while.
+ *
+ * Two ways to pick a cell:
+ *
+ *   SHARD_BY_THREAD  the caller's id, 0..max_threads-1. Each cell has
+ *                    exactly one writer, so an add is a plain load and
+ *                    store rather than a locked instruction.
+ *   SHARD_BY_CPU     the CPU the caller is running on ('sched_getcpu',
+ *                    which the vDSO answers without a system call).
+ *                    Needs no thread ids and stays small with many
+ *                    threads, but a thread can migrate between reading
+ *                    the CPU and adding, so cells take an atomic add.
+ *
+ * A read while writers are running is not a snapshot: cells already
+ * summed keep moving. The result lies somewhere between the total when
+ * the read started and the total when it finished, so the more cells,
+ * the wider that window.
+ */
+
+typedef enum {
+  SHARD_BY_THREAD,
+  SHARD_BY_CPU,
+} shard_index_t;
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) atomic_llong value;
+} counter_cell_t;
+
+typedef struct {
+  counter_cell_t* cells;
+  int             cell_count;
+  shard_index_t   index;
+} sharded_counter_t;
+
+// Allocates the cells, zeroed. 'max_threads' is the number of distinct
+// ids SHARD_BY_THREAD callers will pass; SHARD_BY_CPU ignores it and
+// takes a cell per configured CPU. Returns 0 on success.
+int  sharded_counter_init(sharded_counter_t* counter, shard_index_t index, int max_threads);
+void sharded_counter_destroy(sharded_counter_t* counter);
+
+void      sharded_counter_add(sharded_counter_t* counter, int thread_id, long long delta);
+long long sharded_counter_read(const sharded_counter_t* counter);
+
+// Zeroes every cell. Only safe while nobody is adding.
+void sharded_counter_reset(sharded_counter_t* counter);
+
+#endif // SHARDED_COUNTER_H
@@ -1,12 +1,28 @@
 #include <complex.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <pthread.h>
-#include <math.h>
-
-void print_stats(int successes, int* results, int experiment_count);
+#include <stdint.h>
+#include <string.h>
+
+#include "barrier.h"
+#include "config.h"
+#include "modes.h"
+#include "perf_counters.h"
+#include "platform.h"
+#include "report.h"
+#include "stats.h"
+#include "strategies.h"
+#include "thread_pool.h"
+#include "timestamp.h"
+#include "topology.h"
+
+void print_stats(const increment_strategy_t* strategy, const running_stats_t* results,
+                 long long successes, long long lost_updates,
+                 const running_stats_t* op_ns, const running_stats_t* setup_ns);
 void complex_mode();
 void simple_mode();
 
@@ -32,8 +48,9 @@ void simple_mode();
 // 1 + 1 = 0xabcdef01). Instead we're simply likely to omit 
 // operations. That is 1 + 1 <= 2.
 //
-// Ultimately, you can mess with the Configuration and Shared State
-// section and run the application to see the results. If you want
+// Ultimately, you can mess with the command line options (see
+// '--help' and the Configuration and Shared State section) and run
+// the application to see the results. If you want
 // additional exposition, you can dive into the remaining
 // comments below.
 
@@ -41,47 +58,42 @@ void simple_mode();
 // Configuration and Shared State ---------------------------------
 //-----------------------------------------------------------------
 
-// Caution: program run-time is proporional to the magnitude of these
-// values due to atomic contention. That is... bigger values mean 
-// longer run-times. These settings seem like a good trade off.
-#define MAX_THREADS  10
-#define TOTAL_EXPERIMENTS 100
-
-// Complex mode will do a 'TOTAL_EXPERIMENTS' on 1..'MAX_THREADS'
-// and output statistical data on the value of 'shared_data'.
-// Simple mode does one experiment over 'MAX_THREADS' and report
-// the value of 'MAX_THREADS' and 'shared_data'.
-static bool do_complex_mode = true;
-static bool do_simple_mode = true;
-
-
-// This is here to be changed! By default (0) it will use a non-threadsafe
-// type for the shared state variable 'shared_data' Changing it to
-// non-zero will make the shared state variable use a threadsafe
-// type ('atomic_int'). This will affect the results of the experiments!
-// Settings:
-//   USE_ATOMIC := 0 --> static int shared_data = 0;
-//   USE_ATOMIC := 1 --> static atomic_int shared_data = 0;
-#define USE_ATOMICS 0         
-
-// Declare the number of threads. It is set to 8 here. However,
-// feel free to change this to 2 or whatever. If you do, you'll
-// notice that the probability of incorrect results of decreases. 
-// Why is this
-static atomic_int thread_count = MAX_THREADS;        
+// Everything tunable comes from the command line; see config.c for
+// the defaults.
+//
+// Complex mode will do 'config.experiments' on every thread count
+// in 'config.thread_counts' for every selected increment strategy and
+// output statistical data on the value of the shared counter. With
+// '--ci-width' each of those rows instead runs until its failure rate
+// is known to the requested precision, and with '--budget' the whole
+// sweep fits in a fixed amount of time.
+// Simple mode does one experiment over 'config.max_threads' with the
+// first selected strategy and reports the value of 'thread_count'
+// and 'shared_data'.
+//
+// Spawning a fresh set of pthreads for every experiment costs far more
+// than the experiment itself. With 'config.use_thread_pool' set, a
+// pool of 'config.max_threads' pinned workers is created once and
+// re-armed for every experiment. '--fork-join' restores the original
+// pthread_create/join path so the two can be compared; the
+// "Setup (ns)" column reports the launch overhead of whichever path
+// is in use.
+static config_t config;
+
+// Declare the number of threads. It defaults to the number of online
+// CPUs. However, feel free to change this to 2 or whatever with
+// '--threads'. If you do, you'll notice that the probability of
+// incorrect results of decreases. Why is this
+static atomic_int thread_count = 1;
 
 // Expected value is just the number of threads because each 
 // thread will increment the shared state _once and only once_.
 
-// This variable will be accessed, via loads and stores,
-// by every thread. The type, 'int', provides no consistency
-// or coherence guarentees when accessed concurrently by
-// multiple writers/readers.
-#if !USE_ATOMICS 
-  static int shared_data = 0;
-#else
-  static atomic_int shared_data = 0;
-#endif
+// The strategy the workers use for the current experiment. The shared
+// state itself lives with the strategy; see strategies.c. 'increment'
+// is its increment at 'config.increment_order'.
+static const increment_strategy_t* strategy = NULL;
+static increment_fn_t increment = NULL;
 
 
 // Thread Synchronization -----------------------------------------
@@ -103,24 +115,80 @@ static atomic_int thread_count = MAX_THREADS;
  * call.
  */
 
-// Atomic variable used to create a barrier for threads. This needs
-// to be atomic so that the value of 'wait_lock' is:
+// The barrier is built from atomic variables (see barrier.h). They
+// need to be atomic so that their values are:
 // 1) always coherent: that is, never in an undefined state due to 
 //    reading a partially written value (for example).
 // 2) eventually consistent: the value will eventually reflect the
 //    all the operations that took place on the data. In this case,
 //    it is a trivially provided.
-static atomic_int wait_lock = 0;
+// The algorithm is chosen with '--barrier'. The default is a
+// sense-reversing barrier, so unlike a plain counter nobody has to
+// reset it between experiments. That is what lets the thread pool
+// re-use its workers. 'central' is closest to the original 'wait_lock'
+// counter that every thread incremented and then spun on.
+
+// 'config.barrier' waited on at 'config.barrier_order'.
+static barrier_wait_fn_t barrier_wait = NULL;
 
 // Uses the above global state to ensure that all threads of 
 // execution halt at the same set of instructions. Once all
-// threads arrive, signaled by the condition in the while 
-// construct, they proceed.
-void barrier() {
-  wait_lock += 1;
-  while (wait_lock != thread_count) {}
+// threads arrive they proceed.
+void barrier(int id) {
+  barrier_wait(id);
+}
+
+// Arms the barrier for 'participants' workers. Re-arming is free when
+// nothing changed since the last experiment. Only called between
+// experiments, when no worker is inside it.
+void prepare_barrier(int participants) {
+  if (barrier_arm(config.barrier, participants) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config.barrier->name, participants);
+    exit(1);
+  }
 }
 
+// Timestamps each worker takes during an experiment. Each worker has
+// its own cache line so that taking a stamp never disturbs another
+// worker. Holds 'config.max_threads' entries.
+//  - 'entered': entering 'worker()'. The latest entry minus the time
+//    the launch began is the per-experiment setup overhead.
+//  - 'released': leaving 'barrier()'. The spread between the first and
+//    the last release is how staggered the start actually was.
+//  - 'before_increment'/'after_increment': bracket the increment. When
+//    two workers' brackets overlap they raced on the counter.
+//  - 'perf_before'/'perf_after': hardware counters just outside that
+//    bracket, with '--perf'.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t entered;
+  uint64_t released;
+  uint64_t before_increment;
+  uint64_t after_increment;
+  perf_sample_t perf_before;
+  perf_sample_t perf_after;
+} worker_stamps_t;
+
+static worker_stamps_t* stamps;
+
+// Timestamps the launching thread takes around each experiment.
+//  - 'began'/'ended': the launch starts and every worker has been joined.
+//  - 'created': the last 'pthread_create' returned. Fork-join only.
+typedef struct {
+  uint64_t began;
+  uint64_t created;
+  uint64_t ended;
+} launch_stamps_t;
+
+static launch_stamps_t launch;
+
+// Persistent workers used when 'config.use_thread_pool' is set.
+static thread_pool_t pool;
+
+// CPU each worker runs on under 'config.pin_policy', -1 for unpinned.
+// Pool workers are pinned when the pool is created; fork-join workers
+// pin themselves on entry.
+static int* worker_cpus;
+
 // Primary Functions of the program -------------------------------
 //-----------------------------------------------------------------
 
@@ -135,12 +203,25 @@ void barrier() {
 // Simple worker function that mutates global state.
 // Mutation of state does not occur until all thread
 // have reached 'barrier()'. See in-function comment for more details.
-void* worker(void* _ignored) {
-  barrier();
-  shared_data += 1;
+// The argument is the worker's index, cast to 'void*'.
+void* worker(void* id) {
+  int t = (intptr_t) id;
+  if (!config.use_thread_pool) { pin_current_thread(worker_cpus[t]); }
+  if (config.perf_counters) { perf_counters_attach(t); }
+  stamps[t].entered = ticks_now();
+  barrier(t);
+  stamps[t].released = ticks_now();
+
+  if (config.perf_counters) { perf_counters_read(t, &stamps[t].perf_before); }
+  stamps[t].before_increment = ticks_now();
+  increment(t);
+  stamps[t].after_increment = ticks_now();
+  if (config.perf_counters) { perf_counters_read(t, &stamps[t].perf_after); }
   return NULL;
 /*
- * The assembly for the function 'worker' (with '#define USE_ATOMICS 0') is as follows:
+ * Before strategies were selectable at run-time the increment was written
+ * inline as 'shared_data += 1'. The assembly for 'worker' was as follows
+ * and is what 'plain_increment' in strategies.c still boils down to:
  *  1221:       e8 83 ff ff ff          call   11a9 <barrier>
  *  1226:       8b 05 ec 2d 00 00       mov    eax,DWORD PTR [rip+0x2dec]  # 4018 <shared_data>
  *  122c:       83 c0 01                add    eax,0x1
@@ -207,8 +288,76 @@ void* worker(void* _ignored) {
 
 
 int main(int argc, char** argv) {
-  if (do_complex_mode) { complex_mode(); }
-  if (do_simple_mode)  { simple_mode();  }
+  int parsed = parse_config(&config, argc, argv);
+  if (parsed != 0) { return parsed > 0 ? 0 : 2; }
+
+  calibrate_ticks();
+  barrier_wait = barrier_wait_fn(config.barrier, config.barrier_order);
+  if (config.perf_counters && perf_counters_init(config.max_threads, config.hitm_event) != 0) {
+    config.perf_counters = false;
+  }
+
+  stamps = aligned_alloc(CACHE_LINE_SIZE, sizeof(worker_stamps_t) * config.max_threads);
+  if (stamps == NULL || strategies_init(config.max_threads) != 0) {
+    fprintf(stderr, "Unable to allocate per-worker state.\n");
+    return 1;
+  }
+
+  worker_cpus = calloc(config.max_threads, sizeof(int));
+  if (worker_cpus == NULL) {
+    fprintf(stderr, "Unable to allocate per-worker state.\n");
+    return 1;
+  }
+  if (placement_cpus(config.pin_policy, config.max_threads, worker_cpus) != 0) {
+    fprintf(stderr, "Unable to place workers with policy '%s', leaving them unpinned.\n",
+            pin_policy_name(config.pin_policy));
+  }
+
+  // The pool is created even with '--fork-join': only complex and simple
+  // mode know how to run without it.
+  bool have_pool = thread_pool_create(&pool, config.max_threads, worker_cpus) == 0;
+  if (!have_pool) {
+    fprintf(stderr, "Unable to create thread pool, falling back to pthread_create/join.\n");
+    config.use_thread_pool = false;
+  }
+
+  // Opened only now so that the report records the launch path that is
+  // actually used.
+  if (report_open(&config) != 0) {
+    if (have_pool) { thread_pool_destroy(&pool); }
+    return 1;
+  }
+  if (config.pin_policy != PIN_NONE) {
+    table_printf("Placement (%s):", pin_policy_name(config.pin_policy));
+    for (int t = 0; t < config.max_threads; t++) { table_printf(" %d", worker_cpus[t]); }
+    table_printf("\n");
+  }
+
+  thread_count = config.max_threads;
+  if (config.modes & MODE_COMPLEX) { complex_mode(); }
+  if (config.modes & MODE_SIMPLE)  { simple_mode();  }
+
+  if (have_pool) {
+    if (config.modes & MODE_BARRIER)    { barrier_mode(&config, &pool); }
+    if (config.modes & MODE_THROUGHPUT) { throughput_mode(&config, &pool); }
+    if (config.modes & MODE_STRIDE)     { stride_mode(&config, &pool); }
+    if (config.modes & MODE_ORDERING)   { ordering_mode(&config, &pool); }
+    if (config.modes & MODE_LOCKS)      { lock_mode(&config, &pool); }
+    if (config.modes & MODE_COUNTERS)   { counter_mode(&config, &pool); }
+    if (config.modes & MODE_COMBINING)  { combining_mode(&config, &pool); }
+    if (config.modes & MODE_BACKOFF)    { backoff_mode(&config, &pool); }
+    if (config.modes & MODE_WINDOW)     { window_mode(&config, &pool); }
+    thread_pool_destroy(&pool);
+  }
+  if (config.modes & MODE_PINGPONG) { pingpong_mode(&config); }
+
+  report_close();
+  barrier_disarm();
+  strategies_cleanup();
+  if (config.perf_counters) { perf_counters_cleanup(); }
+  free(worker_cpus);
+  free(stamps);
+  free_config(&config);
 }
 
 void create_threads_and_launch_worker(int thread_count) {
@@ -218,8 +367,9 @@ void create_threads_and_launch_worker(int thread_count) {
   // be executed at the start of the thread. That is, we are specifying that we
   // want THREAD_COUNT threads where they all _only_ execute the function 'worker'.
   for(int t = 0; t < thread_count; t++) {
-    pthread_create(&threads[t], NULL, worker, NULL);
+    pthread_create(&threads[t], NULL, worker, (void*) (intptr_t) t);
   }
+  launch.created = ticks_now();
 
   // This is where we actually spawn the threads we requested. Note that we have
   // to do this sequentially (a for loop). This means that if we didnt use a 'barrier'
@@ -229,77 +379,636 @@ void create_threads_and_launch_worker(int thread_count) {
   }
 }
 
+// Runs one experiment on 'thread_count' workers using either the pool or
+// the fork-join path. Returns the setup overhead in nanoseconds: the time
+// from the start of the launch until the last worker entered 'worker()'.
+long long launch_experiment(int thread_count) {
+  strategy->reset();
+  prepare_barrier(thread_count);
+  launch.began = ticks_now();
+
+  if (config.use_thread_pool) { thread_pool_run(&pool, thread_count, worker); }
+  else                        { create_threads_and_launch_worker(thread_count); }
+  launch.ended = ticks_now();
+
+  uint64_t last_entry = launch.began;
+  for (int t = 0; t < thread_count; t++) {
+    if (stamps[t].entered > last_entry) { last_entry = stamps[t].entered; }
+  }
+  return (long long) ticks_to_ns(last_entry - launch.began);
+}
+
+// Where the time of one experiment went, in nanoseconds. Worker phases
+// are means over the workers:
+//  - 'create':    the 'pthread_create' loop; 0 with the pool.
+//  - 'spawn':     launch start until the worker enters 'worker()'. Includes
+//                 'create' for all but the first worker.
+//  - 'barrier':   entering 'worker()' until leaving 'barrier()'.
+//  - 'increment': the increment itself.
+//  - 'join':      the last increment done until every worker is joined.
+//  - 'total':     launch start until every worker is joined.
+typedef struct {
+  double create_ns;
+  double spawn_ns;
+  double barrier_ns;
+  double increment_ns;
+  double join_ns;
+  double total_ns;
+} launch_phases_t;
+
+launch_phases_t measure_phases(int thread_count) {
+  launch_phases_t phases = { 0, 0, 0, 0, 0, 0 };
+  if (!config.use_thread_pool) { phases.create_ns = ticks_to_ns(launch.created - launch.began); }
+
+  uint64_t last_done = launch.began;
+  for (int t = 0; t < thread_count; t++) {
+    phases.spawn_ns     += ticks_to_ns(stamps[t].entered - launch.began);
+    phases.barrier_ns   += ticks_to_ns(stamps[t].released - stamps[t].entered);
+    phases.increment_ns += ticks_to_ns(stamps[t].after_increment - stamps[t].before_increment);
+    if (stamps[t].after_increment > last_done) { last_done = stamps[t].after_increment; }
+  }
+  phases.spawn_ns     /= thread_count;
+  phases.barrier_ns   /= thread_count;
+  phases.increment_ns /= thread_count;
+  phases.join_ns  = ticks_to_ns(launch.ended - last_done);
+  phases.total_ns = ticks_to_ns(launch.ended - launch.began);
+  return phases;
+}
+
+static void add_phases(launch_phases_t* total, const launch_phases_t* phases) {
+  total->create_ns    += phases->create_ns;
+  total->spawn_ns     += phases->spawn_ns;
+  total->barrier_ns   += phases->barrier_ns;
+  total->increment_ns += phases->increment_ns;
+  total->join_ns      += phases->join_ns;
+  total->total_ns     += phases->total_ns;
+}
+
+// Release skew of one experiment, gathered from the worker stamps.
+typedef struct {
+  double release_spread_ns;   // Last release minus first release.
+  bool   overlapped;          // Some two increments were in flight at once.
+} experiment_timing_t;
+
+static int compare_before_increment(const void* a, const void* b) {
+  uint64_t x = ((const worker_stamps_t*) a)->before_increment;
+  uint64_t y = ((const worker_stamps_t*) b)->before_increment;
+  return (x > y) - (x < y);
+}
+
+experiment_timing_t analyse_timing(int thread_count) {
+  experiment_timing_t timing = { 0, false };
+
+  uint64_t first = UINT64_MAX;
+  uint64_t last = 0;
+  for (int t = 0; t < thread_count; t++) {
+    if (stamps[t].released < first) { first = stamps[t].released; }
+    if (stamps[t].released > last)  { last = stamps[t].released; }
+  }
+  timing.release_spread_ns = ticks_to_ns(last - first);
+
+  // Sorted by start, two increments overlap when one starts before the
+  // latest end seen so far. Sorting reorders the stamps, which is fine:
+  // the experiment is over and the next one overwrites them.
+  qsort(stamps, thread_count, sizeof(worker_stamps_t), compare_before_increment);
+  uint64_t latest_end = 0;
+  for (int t = 0; t < thread_count; t++) {
+    if (t > 0 && stamps[t].before_increment < latest_end) { timing.overlapped = true; }
+    if (stamps[t].after_increment > latest_end) { latest_end = stamps[t].after_increment; }
+  }
+  return timing;
+}
+
+// What complex mode remembers about each (thread count, strategy) row,
+// for its line of the main table and for the tables printed at the end:
+// the release skew split by whether the experiment lost updates, the
+// percentiles of every timing metric and the full distribution of final
+// values. Everything is aggregated as it streams past, so the number of
+// experiments is only limited by patience.
+typedef struct {
+  const increment_strategy_t* strategy;
+  int    thread_count;
+  int    experiments;
+  long long successes;
+  long long lost_updates;
+  running_stats_t results;   // Final counter values.
+  running_stats_t op_stats;  // Increment durations, ns.
+  running_stats_t setup_stats;
+
+  // Timing histograms. All rows share one set, reset as each row
+  // starts; only the percentiles are kept once the row is done.
+  log_histogram_t* op_histogram;
+  log_histogram_t* skew_histogram;
+  log_histogram_t* setup_histogram;
+
+  double elapsed_ns;         // Spent running this row's experiments.
+  bool   converged;          // Reached 'config.ci_width'.
+
+  // Under '--budget': what the pilot batch saw, and the experiments the
+  // plan gives this row.
+  double pilot_rate;
+  double pilot_ns;           // Per experiment.
+  int    planned;
+  int    lossy;              // Experiments that lost at least one update.
+  int    overlapped;         // Experiments whose increments overlapped.
+  int    lossy_overlapped;
+  double spread_total_ns;
+  double spread_lossy_ns;
+  double spread_max_ns;
+
+  percentiles_t op_ns;
+  percentiles_t skew_ns;
+  percentiles_t setup_ns;
+  outcome_histogram_t outcomes;
+  launch_phases_t phases;    // Summed over every experiment.
+  perf_sample_t perf;        // Summed over every worker of every experiment.
+} row_summary_t;
+
+// 95% two-sided.
+#define CI_Z 1.959964
+
+// Experiments between two looks at the confidence interval.
+#define CI_BATCH 10
+
+interval_t row_failure_interval(const row_summary_t* row) {
+  return wilson_interval(row->experiments - row->successes, row->experiments, CI_Z);
+}
+
+void print_skew_summaries(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Release Skew--------------------------\n");
+  table_printf("|Thread_Count | Strategy | Skew (ns) | Skew|lost (ns) | Skew|clean (ns) | Max Skew (ns) | Overlap %% | Lost|Overlap %% |\n");
+
+  for (int r = 0; r < count; r++) {
+    const row_summary_t* row = &summaries[r];
+    int clean = row->experiments - row->lossy;
+
+    table_printf("| %10d  | %-8s | %9.1f | %14.1f | %15.1f | %13.1f | %9.1f | %14.1f |\n",
+                 row->thread_count,
+                 row->strategy->name,
+                 row->spread_total_ns / row->experiments,
+                 row->lossy > 0 ? row->spread_lossy_ns / row->lossy : 0.0,
+                 clean > 0 ? (row->spread_total_ns - row->spread_lossy_ns) / clean : 0.0,
+                 row->spread_max_ns,
+                 100.0 * row->overlapped / row->experiments,
+                 row->overlapped > 0 ? 100.0 * row->lossy_overlapped / row->overlapped : 0.0);
+  }
+}
+
+// How often each final value came up, e.g. "10: 95.00%  9: 4.00%  8: 1.00%".
+void print_outcome_distributions(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Outcome Distribution------------------\n");
+  table_printf("|Thread_Count | Strategy | Final value: share of experiments\n");
+
+  for (int r = 0; r < count; r++) {
+    const outcome_histogram_t* outcomes = &summaries[r].outcomes;
+    table_printf("| %10d  | %-8s |", summaries[r].thread_count, summaries[r].strategy->name);
+    for (int value = outcomes->max_value; value >= 0; value--) {
+      if (outcomes->counts[value] == 0) { continue; }
+      table_printf(" %d: %.2f%% ", value, 100.0 * outcomes->counts[value] / outcomes->count);
+    }
+    table_printf("\n");
+  }
+}
+
+static void print_percentile_row(const row_summary_t* row, const char* metric, const percentiles_t* p) {
+  table_printf("| %10d  | %-8s | %-9s | %10.1f | %10.1f | %10.1f | %10.1f | %12.1f |\n",
+               row->thread_count, row->strategy->name, metric, p->p50, p->p90, p->p99, p->p999, p->max);
+}
+
+// Tails of every timing metric. All values are nanoseconds.
+void print_timing_percentiles(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Timing Percentiles (ns)---------------\n");
+  table_printf("|Thread_Count | Strategy | Metric    |        p50 |        p90 |        p99 |      p99.9 |          Max |\n");
+
+  for (int r = 0; r < count; r++) {
+    print_percentile_row(&summaries[r], "increment", &summaries[r].op_ns);
+    print_percentile_row(&summaries[r], "skew",      &summaries[r].skew_ns);
+    print_percentile_row(&summaries[r], "setup",     &summaries[r].setup_ns);
+  }
+}
+
+// Mean time per experiment in each phase of the launch. 'Harness %' is
+// the share of an experiment that was not the increment: what it costs
+// to measure three instructions.
+void print_phase_breakdown(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Launch Phases (mean ns per experiment)\n");
+  table_printf("|Thread_Count | Strategy |     Create |      Spawn |    Barrier |  Increment |       Join |      Total | Harness %% |\n");
+
+  for (int r = 0; r < count; r++) {
+    const row_summary_t* row = &summaries[r];
+    const launch_phases_t* p = &row->phases;
+    double n = row->experiments;
+
+    table_printf("| %10d  | %-8s |", row->thread_count, row->strategy->name);
+    if (config.use_thread_pool) { table_printf(" %10s |", "-"); }
+    else                        { table_printf(" %10.1f |", p->create_ns / n); }
+    table_printf(" %10.1f | %10.1f | %10.1f | %10.1f | %10.1f | %8.2f%% |\n",
+                 p->spawn_ns / n,
+                 p->barrier_ns / n,
+                 p->increment_ns / n,
+                 p->join_ns / n,
+                 p->total_ns / n,
+                 p->total_ns > 0 ? 100.0 * (1.0 - p->increment_ns / p->total_ns) : 0.0);
+  }
+}
+
+// Hardware counters per increment, next to the updates they lost.
+void print_perf_summaries(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Hardware Counters per Increment-------\n");
+  table_printf("|Thread_Count | Strategy | Lost Updates |");
+  perf_print_header();
+  table_printf("\n");
+
+  for (int r = 0; r < count; r++) {
+    const row_summary_t* row = &summaries[r];
+    table_printf("| %10d  | %-8s | %12lld |", row->thread_count, row->strategy->name, row->lost_updates);
+    perf_print_values(&row->perf, (double) row->experiments * row->thread_count);
+    table_printf("\n");
+  }
+}
+
+// One record per complex mode row with everything the tables above show
+// for it. The outcome distribution is "value:count" pairs separated by
+// spaces, largest value first.
+void report_complex_row(const row_summary_t* row, const running_stats_t* results,
+                        long long successes, long long lost_updates,
+                        const running_stats_t* op_ns, const running_stats_t* setup_ns) {
+  const outcome_histogram_t* outcomes = &row->outcomes;
+  size_t size = (size_t) (outcomes->max_value + 1) * 32 + 1;
+  char* distribution = malloc(size);
+  size_t used = 0;
+  distribution[0] = '\0';
+  for (int value = outcomes->max_value; value >= 0; value--) {
+    if (outcomes->counts[value] == 0) { continue; }
+    used += snprintf(distribution + used, size - used, "%s%d:%lld",
+                     used > 0 ? " " : "", value, outcomes->counts[value]);
+  }
+
+  int clean = row->experiments - row->lossy;
+  interval_t interval = row_failure_interval(row);
+  report_field_t fields[] = {
+    REPORT_STRING("strategy",              row->strategy->name),
+    REPORT_INT   ("thread_count",          row->thread_count),
+    REPORT_INT   ("experiments",           results->count),
+    REPORT_INT   ("failures",              results->count - successes),
+    REPORT_INT   ("lost_updates",          lost_updates),
+    REPORT_INT   ("min",                   (long long) results->min),
+    REPORT_DOUBLE("mean",                  results->mean),
+    REPORT_INT   ("max",                   (long long) results->max),
+    REPORT_DOUBLE("variance",              stats_variance(results)),
+    REPORT_DOUBLE("stddev",                stats_stddev(results)),
+    REPORT_DOUBLE("op_mean_ns",            op_ns->mean),
+    REPORT_DOUBLE("setup_mean_ns",         setup_ns->mean),
+    REPORT_DOUBLE("create_mean_ns",        row->phases.create_ns / row->experiments),
+    REPORT_DOUBLE("spawn_mean_ns",         row->phases.spawn_ns / row->experiments),
+    REPORT_DOUBLE("barrier_mean_ns",       row->phases.barrier_ns / row->experiments),
+    REPORT_DOUBLE("join_mean_ns",          row->phases.join_ns / row->experiments),
+    REPORT_DOUBLE("launch_mean_ns",        row->phases.total_ns / row->experiments),
+    REPORT_DOUBLE("failure_ci_low",        interval.low),
+    REPORT_DOUBLE("failure_ci_high",       interval.high),
+    REPORT_DOUBLE("elapsed_s",             row->elapsed_ns / 1e9),
+    REPORT_INT   ("converged",             row->converged),
+    REPORT_DOUBLE("skew_mean_ns",          row->spread_total_ns / row->experiments),
+    REPORT_DOUBLE("skew_lossy_mean_ns",    row->lossy > 0 ? row->spread_lossy_ns / row->lossy : 0.0),
+    REPORT_DOUBLE("skew_clean_mean_ns",    clean > 0 ? (row->spread_total_ns - row->spread_lossy_ns) / clean : 0.0),
+    REPORT_DOUBLE("overlap_percent",       100.0 * row->overlapped / row->experiments),
+    REPORT_DOUBLE("lost_overlap_percent",  row->overlapped > 0 ? 100.0 * row->lossy_overlapped / row->overlapped : 0.0),
+    REPORT_PERCENTILES("op", row->op_ns),
+    REPORT_PERCENTILES("skew", row->skew_ns),
+    REPORT_PERCENTILES("setup", row->setup_ns),
+    REPORT_STRING("outcomes",              distribution),
+  };
+
+  // Counters only appear in runs with '--perf', so that every row of a
+  // run still has the same columns.
+  int count = sizeof(fields) / sizeof(fields[0]);
+  report_field_t all[sizeof(fields) / sizeof(fields[0]) + PERF_EVENT_COUNT];
+  memcpy(all, fields, sizeof(fields));
+  if (config.perf_counters) {
+    count += perf_report_fields(&row->perf, (double) row->experiments * row->thread_count, all + count);
+  }
+  report_row("complex", all, count);
+  free(distribution);
+}
+
 
 void simple_mode() {
-  printf("\n");
-  printf("Simple Mode--------------------------\n");
+  table_printf("\n");
+  table_printf("Simple Mode--------------------------\n");
+
+  strategy = config.strategies[0];
+  increment = strategy_increment(strategy, config.increment_order);
+  launch_experiment(thread_count);
+  long long shared_data = strategy->read();
+  table_printf("thread_count = %d = %lld = shared_data (%s)\n",
+               (int) thread_count, shared_data, strategy->name);
+
+  report_field_t fields[] = {
+    REPORT_STRING("strategy",     strategy->name),
+    REPORT_INT   ("thread_count", thread_count),
+    REPORT_INT   ("shared_data",  shared_data),
+  };
+  report_row("simple", fields, sizeof(fields) / sizeof(fields[0]));
+}
 
-  create_threads_and_launch_worker(thread_count);
-  printf("thread_count = %d = %d = shared_data\n", thread_count, shared_data); 
 
-  // Reset global variables for next experiment
-  wait_lock = 0;
-  shared_data = 0;
+// Sets up a row; its histograms are only reset by 'reset_histograms'
+// once it is about to run. Returns 0 on success.
+int start_row(row_summary_t* row, const increment_strategy_t* row_strategy, int row_thread_count) {
+  row->strategy = row_strategy;
+  row->thread_count = row_thread_count;
+  stats_init(&row->results);
+  stats_init(&row->op_stats);
+  stats_init(&row->setup_stats);
+  return outcome_histogram_init(&row->outcomes, row_thread_count);
 }
 
+void reset_histograms(row_summary_t* row) {
+  log_histogram_init(row->op_histogram);
+  log_histogram_init(row->skew_histogram);
+  log_histogram_init(row->setup_histogram);
+}
 
-void complex_mode() {
-  printf("\n");
-  printf("Complex Mode--------------------------\n");
-  printf("|Thread_Count | Experiments | Failures |      Min |    Average |      Max |   Variance |   Std Dev  | \n");
+// Points the workers at the row's thread count and strategy.
+void select_row(const row_summary_t* row) {
+  thread_count = row->thread_count;
+  strategy = row->strategy;
+  increment = strategy_increment(strategy, config.increment_order);
+}
 
-  atomic_int original_thread_count = thread_count; // Save off this value so we can reset it later.
+// Runs 'count' more experiments of the selected row 'row'.
+void run_row_experiments(row_summary_t* row, int count) {
+  uint64_t began = ticks_now();
+
+  for (int experiment = 0; experiment < count; experiment++) {
+    long long setup = launch_experiment(thread_count);
+    stats_add(&row->setup_stats, setup);
+    log_histogram_record(row->setup_histogram, setup);
+
+    // Record the final result was consistent/coherent.
+    long long shared_data = strategy->read();
+    row->experiments += 1;
+    if (shared_data == thread_count) { row->successes += 1; }
+    row->lost_updates += thread_count - shared_data;
+    stats_add(&row->results, shared_data);
+    outcome_histogram_record(&row->outcomes, shared_data);
+
+    for (int t = 0; t < thread_count; t++) {
+      double op = ticks_to_ns(stamps[t].after_increment - stamps[t].before_increment);
+      stats_add(&row->op_stats, op);
+      log_histogram_record(row->op_histogram, op);
+      if (config.perf_counters) { perf_sample_accumulate(&row->perf, &stamps[t].perf_before, &stamps[t].perf_after); }
+    }
 
-  for (thread_count = 1; thread_count <= MAX_THREADS; thread_count++) {
-    int successes = 0;
-    int results[TOTAL_EXPERIMENTS];
+    launch_phases_t phases = measure_phases(thread_count);
+    add_phases(&row->phases, &phases);
+
+    // Correlate how staggered the start was with whether it mattered.
+    bool lossy = shared_data != thread_count;
+    experiment_timing_t timing = analyse_timing(thread_count);
+    log_histogram_record(row->skew_histogram, timing.release_spread_ns);
+    row->spread_total_ns += timing.release_spread_ns;
+    if (timing.release_spread_ns > row->spread_max_ns) { row->spread_max_ns = timing.release_spread_ns; }
+    if (lossy)                      { row->lossy += 1; row->spread_lossy_ns += timing.release_spread_ns; }
+    if (timing.overlapped)          { row->overlapped += 1; }
+    if (timing.overlapped && lossy) { row->lossy_overlapped += 1; }
+  }
 
-    for (int experiment = 0; experiment < TOTAL_EXPERIMENTS; experiment++) {
+  row->elapsed_ns += ticks_to_ns(ticks_now() - began);
+}
+
+// Runs the selected row in batches until its failure interval is at
+// most 'config.ci_width' wide or it has used up 'config.row_budget'.
+// A row that never fails converges after ~z^2 / width experiments; one
+// that fails half the time needs ~z^2 / width^2, so the experiments go
+// where the answer is least certain.
+void run_row_to_width(row_summary_t* row) {
+  double budget_ns = config.row_budget * 1e9;
+  while (true) {
+    run_row_experiments(row, CI_BATCH);
+    interval_t interval = row_failure_interval(row);
+    if (interval.high - interval.low <= config.ci_width) { row->converged = true; return; }
+    if (row->elapsed_ns >= budget_ns) { return; }
+  }
+}
 
-      create_threads_and_launch_worker(thread_count);
+// Width of the row's failure interval after 'experiments', if failures
+// keep coming at the rate its pilot saw.
+static double predicted_width(const row_summary_t* row, int experiments) {
+  interval_t interval = wilson_interval(llround(row->pilot_rate * experiments), experiments, CI_Z);
+  return interval.high - interval.low;
+}
 
-      // Record the final result was consistent/coherent.
-      if (shared_data == thread_count) { successes += 1; }
-      results[experiment] = shared_data;
+// Plans 'config.budget' seconds over every row, filling in 'planned'.
+// Each row runs one pilot batch, on a scratch summary so that its real
+// histograms only ever hold its real experiments. Every row gets at
+// least one batch; each further batch goes to the row whose predicted
+// interval is widest, which is the greedy way to make the widest
+// interval as narrow as possible, i.e. to give every row comparable
+// precision. Batches are costed at the row's own pilot time per
+// experiment and stop when the budget is spent. Returns 0 on success.
+int plan_budget(row_summary_t* rows, int count, double budget_ns) {
+  uint64_t began = ticks_now();
+  row_summary_t pilot;
+
+  for (int r = 0; r < count; r++) {
+    memset(&pilot, 0, sizeof(pilot));
+    pilot.op_histogram = rows[r].op_histogram;
+    pilot.skew_histogram = rows[r].skew_histogram;
+    pilot.setup_histogram = rows[r].setup_histogram;
+    if (start_row(&pilot, rows[r].strategy, rows[r].thread_count) != 0) { return -1; }
+    reset_histograms(&pilot);
+    select_row(&pilot);
+    run_row_experiments(&pilot, CI_BATCH);
+    rows[r].pilot_rate = (double) (pilot.experiments - pilot.successes) / pilot.experiments;
+    rows[r].pilot_ns = pilot.elapsed_ns / pilot.experiments;
+    outcome_histogram_free(&pilot.outcomes);
+  }
 
+  double remaining_ns = budget_ns - ticks_to_ns(ticks_now() - began);
+  bool full[count];
+  double width[count];
+  for (int r = 0; r < count; r++) {
+    rows[r].planned = CI_BATCH;
+    remaining_ns -= CI_BATCH * rows[r].pilot_ns;
+    full[r] = config.ci_width > 0 && predicted_width(&rows[r], CI_BATCH) <= config.ci_width;
+    width[r] = predicted_width(&rows[r], CI_BATCH);
+  }
+  if (remaining_ns < 0) {
+    fprintf(stderr, "A %.2f s budget cannot fit one batch per row; running one anyway.\n", config.budget);
+  }
 
-      // Reset global variables for next experiment
-      wait_lock = 0;
-      shared_data = 0;
+  for (;;) {
+    int widest = -1;
+    for (int r = 0; r < count; r++) {
+      if (!full[r] && (widest < 0 || width[r] > width[widest])) { widest = r; }
     }
+    if (widest < 0) { return 0; }
 
-    print_stats(successes, results, TOTAL_EXPERIMENTS);
+    row_summary_t* row = &rows[widest];
+    double batch_ns = CI_BATCH * row->pilot_ns;
+    if (batch_ns > remaining_ns) { full[widest] = true; continue; }
+
+    row->planned += CI_BATCH;
+    remaining_ns -= batch_ns;
+    width[widest] = predicted_width(row, row->planned);
+    if (config.ci_width > 0 && width[widest] <= config.ci_width) { full[widest] = true; }
   }
+}
 
-  thread_count = original_thread_count; // restore thread count incase we want to do simple mode.
+// Pilot times are only estimates. When the time left no longer covers
+// the plan of the rows still to run, scales all of them down alike, so
+// that the overrun does not all land on the last row.
+void fit_plan(row_summary_t* rows, int count, uint64_t began) {
+  double left_ns = config.budget * 1e9 - ticks_to_ns(ticks_now() - began);
+  double needed_ns = 0;
+  for (int r = 0; r < count; r++) { needed_ns += rows[r].planned * rows[r].pilot_ns; }
+  if (needed_ns <= left_ns) { return; }
+
+  double scale = left_ns > 0 ? left_ns / needed_ns : 0;
+  for (int r = 0; r < count; r++) {
+    int planned = (int) (rows[r].planned * scale) / CI_BATCH * CI_BATCH;
+    rows[r].planned = planned > CI_BATCH ? planned : CI_BATCH;
+  }
 }
 
+// Runs the selected row's planned experiments, unless the budget that
+// started at 'began' runs out first.
+void run_planned_row(row_summary_t* row, uint64_t began) {
+  for (int done = 0; done < row->planned; done += CI_BATCH) {
+    if (done > 0 && ticks_to_ns(ticks_now() - began) > config.budget * 1e9) { break; }
+    run_row_experiments(row, CI_BATCH);
+  }
+  interval_t interval = row_failure_interval(row);
+  row->converged = config.ci_width > 0 && interval.high - interval.low <= config.ci_width;
+}
+
+// Prints and reports the row's line of the main table and keeps the
+// percentiles of its histograms.
+void finish_row(row_summary_t* row) {
+  row->op_ns = log_histogram_percentiles(row->op_histogram);
+  row->skew_ns = log_histogram_percentiles(row->skew_histogram);
+  row->setup_ns = log_histogram_percentiles(row->setup_histogram);
+  print_stats(row->strategy, &row->results, row->successes, row->lost_updates, &row->op_stats, &row->setup_stats);
+  report_complex_row(row, &row->results, row->successes, row->lost_updates, &row->op_stats, &row->setup_stats);
+}
+
+// How precisely each row pinned down its failure probability, and how
+// long it took.
+void print_convergence(const row_summary_t* summaries, int count) {
+  table_printf("\n");
+  table_printf("Failure Probability (95%% Wilson interval)\n");
+  table_printf("|Thread_Count | Strategy | Experiments |  P(fail) |      Low |     High |    Width | Mean +-95%% | Time (s) | Stop      |\n");
+
+  for (int r = 0; r < count; r++) {
+    const row_summary_t* row = &summaries[r];
+    double p = row->experiments > 0 ? (double) (row->experiments - row->successes) / row->experiments : 0;
+    interval_t interval = row_failure_interval(row);
+    double mean_half = row->experiments > 0 ? CI_Z * stats_stddev(&row->results) / sqrt(row->experiments) : 0;
+
+    table_printf("| %10d  | %-8s | %11d | %8.5f | %8.5f | %8.5f | %8.5f | %10.4f | %8.2f | %-9s |\n",
+                 row->thread_count,
+                 row->strategy->name,
+                 row->experiments,
+                 p,
+                 interval.low,
+                 interval.high,
+                 interval.high - interval.low,
+                 mean_half,
+                 row->elapsed_ns / 1e9,
+                 row->converged ? "converged" : "budget");
+  }
+}
 
-void print_stats(int successes, int* results, int experiment_count) {
-  float average, variance, std_deviation, sum = 0, sum1 = 0;
+// Sets up every row over the shared 'histograms' and runs it. Returns
+// 0 on success; '*summary_count' rows were set up and need freeing
+// either way.
+int run_complex_rows(row_summary_t* summaries, log_histogram_t* histograms, int* summary_count) {
+  // Strategies are the inner loop so that every strategy at a given thread
+  // count runs back to back, on the same machine state.
+  for (int c = 0; c < config.thread_count_len; c++) {
+    for (int s = 0; s < config.strategy_count; s++) {
+      row_summary_t* summary = &summaries[*summary_count];
+      summary->op_histogram = &histograms[0];
+      summary->skew_histogram = &histograms[1];
+      summary->setup_histogram = &histograms[2];
+      if (start_row(summary, config.strategies[s], config.thread_counts[c]) != 0) { return -1; }
+      *summary_count += 1;
+    }
+  }
 
-  int min = MAX_THREADS + 1;
-  int max = 0;
-  for (int i = 0; i < experiment_count; i++) {
-    sum = sum + results[i];
-    if (results[i] > max) { max = results[i]; }
-    if (results[i] < min) { min = results[i]; }
+  uint64_t began = ticks_now();
+  if (config.budget > 0 && plan_budget(summaries, *summary_count, config.budget * 1e9) != 0) { return -1; }
+
+  for (int r = 0; r < *summary_count; r++) {
+    row_summary_t* summary = &summaries[r];
+    reset_histograms(summary);
+    select_row(summary);
+    if (config.budget > 0) {
+      fit_plan(summary, *summary_count - r, began);
+      run_planned_row(summary, began);
+    } else if (config.ci_width > 0) {
+      run_row_to_width(summary);
+    } else {
+      run_row_experiments(summary, config.experiments);
+    }
+    finish_row(summary);
   }
-  average = sum / (float) experiment_count;
+  return 0;
+}
 
-  for (int i = 0; i < experiment_count ; i++) {
-    sum1 = sum1 + pow((results[i] - average), 2);
+void complex_mode() {
+  table_printf("\n");
+  table_printf("Complex Mode--------------------------\n");
+  table_printf("|Thread_Count | Strategy | Experiments | Failures | Lost Updates |      Min |    Average |      Max |   Variance |   Std Dev  |    ns/op | Setup (ns) | \n");
+
+  atomic_int original_thread_count = thread_count; // Save off this value so we can reset it later.
+
+  // One summary per table row, printed as further tables at the end.
+  // Rows run one after the other, so they share one set of histograms.
+  row_summary_t* summaries = calloc(config.thread_count_len * config.strategy_count, sizeof(row_summary_t));
+  log_histogram_t* histograms = malloc(sizeof(log_histogram_t) * 3);
+  int summary_count = 0;
+
+  if (summaries == NULL || histograms == NULL ||
+      run_complex_rows(summaries, histograms, &summary_count) != 0) {
+    fprintf(stderr, "Unable to allocate complex mode state.\n");
+  } else {
+    print_skew_summaries(summaries, summary_count);
+    print_outcome_distributions(summaries, summary_count);
+    print_timing_percentiles(summaries, summary_count);
+    print_phase_breakdown(summaries, summary_count);
+    if (config.ci_width > 0 || config.budget > 0) { print_convergence(summaries, summary_count); }
+    if (config.perf_counters) { print_perf_summaries(summaries, summary_count); }
   }
 
-  variance = sum1 / (float) experiment_count;
-  std_deviation = sqrt(variance);
-  printf("| %10d  | %10d  | %8d | %8d | %10.2f | %8d | %10.2f | %10.2f |\n", 
+  for (int r = 0; r < summary_count; r++) { outcome_histogram_free(&summaries[r].outcomes); }
+  free(summaries);
+  free(histograms);
+
+  thread_count = original_thread_count; // restore thread count incase we want to do simple mode.
+}
+
+
+void print_stats(const increment_strategy_t* strategy, const running_stats_t* results,
+                 long long successes, long long lost_updates,
+                 const running_stats_t* op_ns, const running_stats_t* setup_ns) {
+  table_printf("| %10d  | %-8s | %10lld  | %8lld | %12lld | %8lld | %10.2f | %8lld | %10.2f | %10.2f | %8.1f | %10.0f |\n", 
                                       thread_count,
-                                      TOTAL_EXPERIMENTS,
-                                      TOTAL_EXPERIMENTS - successes,
-                                      min,
-                                      average,
-                                      max,
-                                      variance,
-                                      std_deviation);
+                                      strategy->name,
+                                      results->count,
+                                      results->count - successes,
+                                      lost_updates,
+                                      (long long) results->min,
+                                      results->mean,
+                                      (long long) results->max,
+                                      stats_variance(results),
+                                      stats_stddev(results),
+                                      op_ns->mean,
+                                      setup_ns->mean);
 }
@@ -0,0 +1,205 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+void stats_init(running_stats_t* stats) {
+  stats->count = 0;
+  stats->mean = 0;
+  stats->m2 = 0;
+  stats->min = INFINITY;
+  stats->max = -INFINITY;
+}
+
+void stats_add(running_stats_t* stats, double sample) {
+  stats->count += 1;
+  double delta = sample - stats->mean;
+  stats->mean += delta / stats->count;
+  stats->m2 += delta * (sample - stats->mean);
+
+  if (sample < stats->min) { stats->min = sample; }
+  if (sample > stats->max) { stats->max = sample; }
+}
+
+void stats_merge(running_stats_t* into, const running_stats_t* from) {
+  if (from->count == 0) { return; }
+  if (into->count == 0) { *into = *from; return; }
+
+  long long count = into->count + from->count;
+  double delta = from->mean - into->mean;
+
+  into->mean += delta * from->count / count;
+  into->m2 += from->m2 + delta * delta * ((double) into->count * from->count / count);
+  into->count = count;
+
+  if (from->min < into->min) { into->min = from->min; }
+  if (from->max > into->max) { into->max = from->max; }
+}
+
+double stats_variance(const running_stats_t* stats) {
+  return stats->count > 1 ? stats->m2 / stats->count : 0;
+}
+
+double stats_stddev(const running_stats_t* stats) { return sqrt(stats_variance(stats)); }
+
+interval_t wilson_interval(long long hits, long long trials, double z) {
+  interval_t interval = { 0, 1 };
+  if (trials <= 0) { return interval; }
+
+  double n = trials;
+  double p = hits / n;
+  double z2 = z * z;
+  double centre = (p + z2 / (2 * n)) / (1 + z2 / n);
+  double half = z / (1 + z2 / n) * sqrt(p * (1 - p) / n + z2 / (4 * n * n));
+  interval.low = fmax(centre - half, 0);
+  interval.high = fmin(centre + half, 1);
+  return interval;
+}
+
+int outcome_histogram_init(outcome_histogram_t* histogram, int max_value) {
+  histogram->max_value = max_value;
+  histogram->count = 0;
+  histogram->counts = calloc(max_value + 1, sizeof(long long));
+  return histogram->counts != NULL ? 0 : -1;
+}
+
+void outcome_histogram_record(outcome_histogram_t* histogram, long long value) {
+  if (value < 0)                     { value = 0; }
+  if (value > histogram->max_value)  { value = histogram->max_value; }
+  histogram->counts[value] += 1;
+  histogram->count += 1;
+}
+
+void outcome_histogram_free(outcome_histogram_t* histogram) {
+  free(histogram->counts);
+  histogram->counts = NULL;
+}
+
+#define SUB_BUCKETS  (1 << LOG_HISTOGRAM_SUB_BITS)
+#define HALF_BUCKETS (1 << (LOG_HISTOGRAM_SUB_BITS - 1))
+
+static int bucket_index(uint64_t value) {
+  if (value < SUB_BUCKETS) { return (int) value; }
+
+  // Keep the top SUB_BITS bits; 'top' lands in [HALF_BUCKETS, SUB_BUCKETS).
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - (LOG_HISTOGRAM_SUB_BITS - 1);
+  int top = (int) (value >> shift);
+  return SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + (top - HALF_BUCKETS);
+}
+
+// Midpoint of the values that map to 'index'.
+static double bucket_value(int index) {
+  if (index < SUB_BUCKETS) { return index; }
+
+  int shift = (index - SUB_BUCKETS) / HALF_BUCKETS + 1;
+  int top = (index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+  double low = ldexp(top, shift);
+  return low + ldexp(1, shift) / 2;
+}
+
+void log_histogram_init(log_histogram_t* histogram) { memset(histogram, 0, sizeof(*histogram)); }
+
+void log_histogram_record(log_histogram_t* histogram, uint64_t value) {
+  histogram->buckets[bucket_index(value)] += 1;
+  histogram->count += 1;
+  if (value > histogram->max) { histogram->max = value; }
+}
+
+void log_histogram_merge(log_histogram_t* into, const log_histogram_t* from) {
+  for (int b = 0; b < LOG_HISTOGRAM_BUCKETS; b++) { into->buckets[b] += from->buckets[b]; }
+  into->count += from->count;
+  if (from->max > into->max) { into->max = from->max; }
+}
+
+double log_histogram_percentile(const log_histogram_t* histogram, double percentile) {
+  if (histogram->count == 0) { return 0; }
+
+  long long rank = (long long) ceil(percentile / 100.0 * histogram->count);
+  if (rank < 1) { rank = 1; }
+
+  long long seen = 0;
+  for (int b = 0; b < LOG_HISTOGRAM_BUCKETS; b++) {
+    seen += histogram->buckets[b];
+    if (seen >= rank) {
+      // The midpoint of the last bucket can lie above anything recorded.
+      double value = bucket_value(b);
+      return value < histogram->max ? value : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+percentiles_t log_histogram_percentiles(const log_histogram_t* histogram) {
+  percentiles_t p;
+  p.p50  = log_histogram_percentile(histogram, 50);
+  p.p90  = log_histogram_percentile(histogram, 90);
+  p.p99  = log_histogram_percentile(histogram, 99);
+  p.p999 = log_histogram_percentile(histogram, 99.9);
+  p.max  = histogram->max;
+  return p;
+}
+
+double scalability_predict(const scalability_fit_t* fit, double baseline, double threads) {
+  return baseline * threads / (1 + fit->sigma * (threads - 1) + fit->kappa * threads * (threads - 1));
+}
+
+int scalability_fit(const int* threads, const double* throughput, int count, double baseline,
+                    bool coherency, scalability_fit_t* fit) {
+  memset(fit, 0, sizeof(*fit));
+
+  // Normal equations for y = sigma x1 + kappa x2.
+  double a11 = 0, a12 = 0, a22 = 0, b1 = 0, b2 = 0;
+  int above_one = 0;
+  for (int i = 0; i < count; i++) {
+    if (threads[i] < 1 || throughput[i] <= 0) { continue; }
+    double n = threads[i];
+    double x1 = n - 1;
+    double x2 = n * (n - 1);
+    double y = n * baseline / throughput[i] - 1;
+    a11 += x1 * x1;
+    a12 += x1 * x2;
+    a22 += x2 * x2;
+    b1 += x1 * y;
+    b2 += x2 * y;
+    fit->points += 1;
+    above_one += threads[i] > 1;
+  }
+  if (baseline <= 0 || above_one < (coherency ? 2 : 1)) { return -1; }
+
+  // Repeated thread counts can leave only one distinct N above one.
+  double det = a11 * a22 - a12 * a12;
+  if (coherency && det <= 1e-12 * a11 * a22) { coherency = false; }
+
+  if (coherency) {
+    fit->sigma = (b1 * a22 - b2 * a12) / det;
+    fit->kappa = (a11 * b2 - a12 * b1) / det;
+  } else {
+    fit->sigma = b1 / a11;
+  }
+  if (fit->kappa < 0) { fit->kappa = 0; fit->sigma = b1 / a11; }
+  if (fit->sigma < 0) { fit->sigma = 0; fit->kappa = coherency ? fmax(b2 / a22, 0) : 0; }
+
+  if (fit->kappa > 0) {
+    fit->peak_threads = fit->sigma < 1 ? sqrt((1 - fit->sigma) / fit->kappa) : 1;
+    fit->peak_throughput = scalability_predict(fit, baseline, fit->peak_threads);
+  } else if (fit->sigma >= 1) {
+    // Every thread added costs more than it brings: one thread is best.
+    fit->peak_threads = 1;
+    fit->peak_throughput = baseline;
+  } else {
+    fit->peak_threads = INFINITY;
+    fit->peak_throughput = fit->sigma > 0 ? baseline / fit->sigma : INFINITY;
+  }
+
+  double squares = 0;
+  for (int i = 0; i < count; i++) {
+    if (threads[i] < 1 || throughput[i] <= 0) { continue; }
+    double residual = (throughput[i] - scalability_predict(fit, baseline, threads[i])) / throughput[i];
+    squares += residual * residual;
+    if (fabs(residual) > fabs(fit->max_residual)) { fit->max_residual = residual; }
+  }
+  fit->rms_residual = sqrt(squares / fit->points);
+  return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streaming Statistics -------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Count, mean, variance, min and max of a stream of samples in O(1)
+ * memory. The mean and the sum of squared deviations ('m2') are updated
+ * with Welford's recurrence, which does not lose precision the way
+ * 'sum of squares minus square of sums' does once the count is large.
+ * Two aggregators over disjoint samples merge exactly (Chan et al.), so
+ * each thread can keep its own and combine them at the end.
+ */
+
+typedef struct {
+  long long count;
+  double mean;
+  double m2;
+  double min;
+  double max;
+} running_stats_t;
+
+void stats_init(running_stats_t* stats);
+void stats_add(running_stats_t* stats, double sample);
+void stats_merge(running_stats_t* into, const running_stats_t* from);
+
+// Population variance and standard deviation; 0 for fewer than two samples.
+double stats_variance(const running_stats_t* stats);
+double stats_stddev(const running_stats_t* stats);
+
+// Two-sided 'z' standard deviation Wilson score interval for the
+// probability behind 'hits' out of 'trials'. Unlike the textbook
+// p +- z sqrt(p (1 - p) / n) it stays inside [0, 1] and does not
+// collapse to zero width when no hit has been seen yet, which is exactly
+// the case for a rare failure.
+typedef struct {
+  double low;
+  double high;
+} interval_t;
+
+interval_t wilson_interval(long long hits, long long trials, double z);
+
+// Outcome Histogram ----------------------------------------------
+//-----------------------------------------------------------------
+
+// Exact count of every final counter value from 0 to 'max_value'. With
+// one increment per thread the values are small, so every outcome gets
+// its own bucket. Values outside the range land in the nearest end.
+typedef struct {
+  int max_value;
+  long long count;
+  long long* counts;
+} outcome_histogram_t;
+
+// Returns 0 on success.
+int  outcome_histogram_init(outcome_histogram_t* histogram, int max_value);
+void outcome_histogram_record(outcome_histogram_t* histogram, long long value);
+void outcome_histogram_free(outcome_histogram_t* histogram);
+
+// Log-Bucketed Histogram -----------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * HDR-style histogram for latencies. Values below 2^SUB_BITS get a
+ * bucket each; above that, every power of two is split into
+ * 2^(SUB_BITS-1) equal buckets, so a bucket is never wider than 1/64 of
+ * the values it holds. Recording is a count-leading-zeros and a shift,
+ * whatever the value. The whole 64-bit range fits in ~30KB.
+ */
+#define LOG_HISTOGRAM_SUB_BITS 7
+#define LOG_HISTOGRAM_BUCKETS  ((1 << LOG_HISTOGRAM_SUB_BITS) + \
+                                (64 - LOG_HISTOGRAM_SUB_BITS) * (1 << (LOG_HISTOGRAM_SUB_BITS - 1)))
+
+typedef struct {
+  long long count;
+  uint64_t  max;
+  long long buckets[LOG_HISTOGRAM_BUCKETS];
+} log_histogram_t;
+
+// The percentiles every timing table reports.
+typedef struct {
+  double p50;
+  double p90;
+  double p99;
+  double p999;
+  double max;
+} percentiles_t;
+
+void log_histogram_init(log_histogram_t* histogram);
+void log_histogram_record(log_histogram_t* histogram, uint64_t value);
+void log_histogram_merge(log_histogram_t* into, const log_histogram_t* from);
+
+// Smallest recorded value (to bucket precision) that at least
+// 'percentile' percent of the samples do not exceed.
+double log_histogram_percentile(const log_histogram_t* histogram, double percentile);
+percentiles_t log_histogram_percentiles(const log_histogram_t* histogram);
+
+// Scalability Models ---------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Gunther's Universal Scalability Law models throughput at N threads as
+ *
+ *   X(N) = X(1) N / (1 + sigma (N - 1) + kappa N (N - 1))
+ *
+ * 'sigma' is contention: the share of the work that queues for a shared
+ * resource. On its own (kappa = 0) it is Amdahl's law, and throughput
+ * levels off at X(1) / sigma. 'kappa' is coherency: the cost of keeping
+ * every thread's view of shared state consistent. It grows with the
+ * number of pairs of threads, so any kappa > 0 puts a peak at
+ * N* = sqrt((1 - sigma) / kappa) and makes throughput fall beyond it.
+ * A cache line bouncing between cores is the textbook case.
+ *
+ * Dividing through, N X(1) / X(N) - 1 = sigma (N - 1) + kappa N (N - 1),
+ * which is linear in both parameters, so the fit is ordinary least
+ * squares with no intercept. Neither parameter may be negative: when the
+ * unconstrained fit makes one negative it is pinned to 0 and the other
+ * refitted alone.
+ */
+
+typedef struct {
+  int    points;
+  double sigma;
+  double kappa;
+  double peak_threads;       // N*; INFINITY when kappa is 0.
+  double peak_throughput;    // X(N*), or the Amdahl ceiling X(1) / sigma.
+  double rms_residual;       // Of (measured - fitted) / measured.
+  double max_residual;       // Largest such relative residual, signed.
+} scalability_fit_t;
+
+// Fits the 'count' measurements 'throughput[i]' at 'threads[i]' threads,
+// relative to the single-thread throughput 'baseline'. With 'coherency'
+// false kappa stays 0, which is Amdahl's law. Returns 0 on success and
+// -1 when there are too few thread counts above one to fit.
+int scalability_fit(const int* threads, const double* throughput, int count, double baseline,
+                    bool coherency, scalability_fit_t* fit);
+
+// Throughput the fitted model predicts at 'threads'.
+double scalability_predict(const scalability_fit_t* fit, double baseline, double threads);
+
+#endif // STATS_H
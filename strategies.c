@@ -0,0 +1,228 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive_counter.h"
+#include "flat_combining.h"
+#include "platform.h"
+#include "sharded_counter.h"
+#include "strategies.h"
+
+// Plain ----------------------------------------------------------
+//-----------------------------------------------------------------
+
+// This variable will be accessed, via loads and stores,
+// by every thread. The type, 'int', provides no consistency
+// or coherence guarentees when accessed concurrently by
+// multiple writers/readers.
+static int shared_data = 0;
+
+static void      plain_reset(void)              { shared_data = 0; }
+static void      plain_increment(int _ignored) { shared_data += 1; }
+static long long plain_read(void)               { return shared_data; }
+
+// Volatile -------------------------------------------------------
+//-----------------------------------------------------------------
+
+// 'volatile' forces the compiler to emit a load and a store for every
+// access, but it says nothing to the processor. The load/add/store
+// sequence is exactly as racy as the plain version.
+static volatile int volatile_data = 0;
+
+static void      volatile_reset(void)              { volatile_data = 0; }
+static void      volatile_increment(int _ignored) { volatile_data += 1; }
+static long long volatile_read(void)               { return volatile_data; }
+
+// Atomic fetch-add -----------------------------------------------
+//-----------------------------------------------------------------
+
+// A single read-modify-write instruction ('lock xadd' on x86) that the
+// processor guarantees to be indivisible.
+static atomic_int atomic_data = 0;
+
+static void      atomic_reset(void)              { atomic_store(&atomic_data, 0); }
+static void      atomic_increment(int _ignored) { atomic_fetch_add(&atomic_data, 1); }
+static long long atomic_read(void)               { return atomic_load(&atomic_data); }
+
+// Atomicity does not depend on ordering: even a relaxed fetch-add never
+// loses an update. Ordering only decides what else becomes visible
+// along with it.
+ORDER_INLINE void atomic_increment_ordered(int _ignored, memory_ordering_t o) {
+  atomic_fetch_add_explicit(&atomic_data, 1, ORDER_BOTH(o));
+}
+ORDERED_VARIANTS(atomic_increment)
+
+// Compare-and-swap loop ------------------------------------------
+//-----------------------------------------------------------------
+
+// Read the value, compute the new one, and only publish it if nobody
+// changed the value in the mean time. On failure 'expected' is reloaded
+// with the current value and we try again.
+static atomic_int cas_data = 0;
+
+static void cas_reset(void) { atomic_store(&cas_data, 0); }
+
+static void cas_increment(int _ignored) {
+  int expected = atomic_load_explicit(&cas_data, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak(&cas_data, &expected, expected + 1)) {}
+}
+
+static long long cas_read(void) { return atomic_load(&cas_data); }
+
+ORDER_INLINE void cas_increment_ordered(int _ignored, memory_ordering_t o) {
+  int expected = atomic_load_explicit(&cas_data, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&cas_data, &expected, expected + 1,
+                                                ORDER_BOTH(o), ORDER_CAS_FAILURE(o))) {}
+}
+ORDERED_VARIANTS(cas_increment)
+
+// pthread_mutex --------------------------------------------------
+//-----------------------------------------------------------------
+
+static pthread_mutex_t mutex_lock = PTHREAD_MUTEX_INITIALIZER;
+static int mutex_data = 0;
+
+static void mutex_reset(void) { mutex_data = 0; }
+
+static void mutex_increment(int _ignored) {
+  pthread_mutex_lock(&mutex_lock);
+  mutex_data += 1;
+  pthread_mutex_unlock(&mutex_lock);
+}
+
+static long long mutex_read(void) { return mutex_data; }
+
+// Spinlock -------------------------------------------------------
+//-----------------------------------------------------------------
+
+static atomic_flag spin_flag = ATOMIC_FLAG_INIT;
+static int spin_data = 0;
+
+static void spin_reset(void) { spin_data = 0; }
+
+static void spin_increment(int _ignored) {
+  while (atomic_flag_test_and_set_explicit(&spin_flag, memory_order_acquire)) {
+    cpu_relax();
+  }
+  spin_data += 1;
+  atomic_flag_clear_explicit(&spin_flag, memory_order_release);
+}
+
+static long long spin_read(void) { return spin_data; }
+
+// Unlike the counters above, a lock leans on its ordering: with relaxed
+// the increment is free to leak out of the critical section.
+ORDER_INLINE void spin_increment_ordered(int _ignored, memory_ordering_t o) {
+  while (atomic_flag_test_and_set_explicit(&spin_flag, ORDER_ACQUIRE(o))) {
+    cpu_relax();
+  }
+  spin_data += 1;
+  atomic_flag_clear_explicit(&spin_flag, ORDER_RELEASE(o));
+}
+ORDERED_VARIANTS(spin_increment)
+
+// Sharded --------------------------------------------------------
+//-----------------------------------------------------------------
+
+// Every worker increments its own cache line, so there is nothing to
+// race on. The price is paid by the reader, who has to visit every
+// shard to compute the total. 'percpu' picks the line by the CPU
+// the worker is running on instead, which needs a locked add but only
+// contends when two workers share a CPU. See sharded_counter.h.
+static sharded_counter_t thread_shards;
+static sharded_counter_t cpu_shards;
+
+static void      sharded_reset(void)              { sharded_counter_reset(&thread_shards); }
+static void      sharded_increment(int worker_id) { sharded_counter_add(&thread_shards, worker_id, 1); }
+static long long sharded_read(void)               { return sharded_counter_read(&thread_shards); }
+static int       sharded_footprint(void)          { return thread_shards.cell_count; }
+
+static void      percpu_reset(void)              { sharded_counter_reset(&cpu_shards); }
+static void      percpu_increment(int worker_id) { sharded_counter_add(&cpu_shards, worker_id, 1); }
+static long long percpu_read(void)               { return sharded_counter_read(&cpu_shards); }
+static int       percpu_footprint(void)          { return cpu_shards.cell_count; }
+
+// Adaptive -------------------------------------------------------
+//-----------------------------------------------------------------
+
+// One atomic until a CAS on it fails, then cells allocated on demand.
+// See adaptive_counter.h.
+static adaptive_counter_t adaptive;
+
+static void      adaptive_reset(void)              { adaptive_counter_reset(&adaptive); }
+static void      adaptive_increment(int worker_id) { adaptive_counter_add(&adaptive, worker_id, 1); }
+static long long adaptive_read(void)               { return adaptive_counter_read(&adaptive); }
+static int       adaptive_footprint(void)          { return adaptive_counter_footprint(&adaptive); }
+
+// Flat combining -------------------------------------------------
+//-----------------------------------------------------------------
+
+// Workers post their increment in a slot and one of them, holding the
+// combiner lock, applies every posted increment in a single pass. See
+// flat_combining.h.
+static flat_counter_t combining;
+
+static void      combiner_reset(void)              { flat_counter_reset(&combining); }
+static void      combiner_increment(int worker_id) { flat_counter_add(&combining, worker_id, 1); }
+static long long combiner_read(void)               { return flat_counter_read(&combining); }
+static double    combiner_degree(void)             { return flat_counter_degree(&combining); }
+
+// Strategy Table -------------------------------------------------
+//-----------------------------------------------------------------
+
+const increment_strategy_t increment_strategies[] = {
+  { "plain",    "static int, load/add/store",         false, 32, plain_reset,    plain_increment,    plain_read,    NULL,                      NULL,               NULL            },
+  { "volatile", "static volatile int",                false, 32, volatile_reset, volatile_increment, volatile_read, NULL,                      NULL,               NULL            },
+  { "atomic",   "atomic_fetch_add on atomic_int",     true,  32, atomic_reset,   atomic_increment,   atomic_read,   atomic_increment_by_order, NULL,               NULL            },
+  { "cas",      "compare-and-swap retry loop",        true,  32, cas_reset,      cas_increment,      cas_read,      cas_increment_by_order,    NULL,               NULL            },
+  { "mutex",    "pthread_mutex around int",           true,  32, mutex_reset,    mutex_increment,    mutex_read,    NULL,                      NULL,               NULL            },
+  { "spinlock", "test-and-set spinlock around int",   true,  32, spin_reset,     spin_increment,     spin_read,     spin_increment_by_order,   NULL,               NULL            },
+  { "sharded",  "per-worker cache-line padded cells", true,  64, sharded_reset,  sharded_increment,  sharded_read,  NULL,                      sharded_footprint,  NULL            },
+  { "percpu",   "per-CPU padded cells, sched_getcpu", true,  64, percpu_reset,   percpu_increment,   percpu_read,   NULL,                      percpu_footprint,   NULL            },
+  { "adaptive", "one CAS word, inflates to cells",    true,  64, adaptive_reset, adaptive_increment, adaptive_read, NULL,                      adaptive_footprint, NULL            },
+  { "combiner", "flat combining, one pass per batch", true,  64, combiner_reset, combiner_increment, combiner_read, NULL,                      NULL,               combiner_degree },
+};
+
+const int increment_strategy_count = sizeof(increment_strategies) / sizeof(increment_strategies[0]);
+
+int strategies_init(int max_workers) {
+  if (sharded_counter_init(&thread_shards, SHARD_BY_THREAD, max_workers) != 0) { return -1; }
+  if (sharded_counter_init(&cpu_shards, SHARD_BY_CPU, max_workers) != 0) {
+    sharded_counter_destroy(&thread_shards);
+    return -1;
+  }
+  if (flat_counter_init(&combining, max_workers) != 0) {
+    sharded_counter_destroy(&thread_shards);
+    sharded_counter_destroy(&cpu_shards);
+    return -1;
+  }
+  return adaptive_counter_init(&adaptive);
+}
+
+void strategies_cleanup(void) {
+  sharded_counter_destroy(&thread_shards);
+  sharded_counter_destroy(&cpu_shards);
+  adaptive_counter_destroy(&adaptive);
+  flat_counter_destroy(&combining);
+}
+
+const increment_strategy_t* find_strategy(const char* name) {
+  for (int s = 0; s < increment_strategy_count; s++) {
+    if (strcmp(increment_strategies[s].name, name) == 0) { return &increment_strategies[s]; }
+  }
+  return NULL;
+}
+
+increment_fn_t strategy_increment(const increment_strategy_t* strategy, memory_ordering_t ordering) {
+  if (ordering == ORDER_DEFAULT || strategy->ordered == NULL) { return strategy->increment; }
+  return strategy->ordered[ordering];
+}
+
+int strategy_footprint(const increment_strategy_t* strategy) {
+  return strategy->footprint != NULL ? strategy->footprint() : 1;
+}
+
+double strategy_combining_degree(const increment_strategy_t* strategy) {
+  return strategy->combining_degree != NULL ? strategy->combining_degree() : 0;
+}
@@ -0,0 +1,69 @@
+#ifndef STRATEGIES_H
+#define STRATEGIES_H
+
+#include <stdbool.h>
+
+#include "ordering.h"
+
+// Increment Strategies -------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Each strategy is a different way of answering the same question:
+ * how do N threads add one to a shared counter? They range from the
+ * deliberately broken ('plain', 'volatile') through hardware atomics
+ * to locks, sharded counters that avoid sharing altogether or only
+ * start sharding once they are contended, and flat combining, which
+ * batches everyone's increments into one.
+ *
+ * Every strategy owns its own counter state. 'reset' zeroes it before
+ * an experiment, 'increment' is called by each worker after the
+ * barrier, and 'read' returns the final value once all workers have
+ * finished. Strategies built on atomics also provide 'ordered', their
+ * increment at each memory ordering level (see ordering.h); the others
+ * leave it NULL. Likewise 'footprint' and 'combining_degree' are only
+ * provided by the strategies they say something about; NULL means the
+ * default of strategy_footprint and strategy_combining_degree.
+ */
+
+typedef void (*increment_fn_t)(int worker_id);
+
+typedef struct {
+  const char* name;
+  const char* description;
+  bool        thread_safe;   // Whether lost updates are a bug or the point.
+  int         counter_bits;  // 32 for the int based counters, which wrap; 64 otherwise.
+
+  void      (*reset)(void);
+  increment_fn_t increment;
+  long long (*read)(void);
+
+  const increment_fn_t* ordered;
+  int       (*footprint)(void);
+  double    (*combining_degree)(void);
+} increment_strategy_t;
+
+extern const increment_strategy_t increment_strategies[];
+extern const int increment_strategy_count;
+
+// Allocates per-worker state for up to 'max_workers' workers.
+// Returns 0 on success.
+int strategies_init(int max_workers);
+void strategies_cleanup(void);
+
+// Returns the strategy called 'name' or NULL if there is none.
+const increment_strategy_t* find_strategy(const char* name);
+
+// The increment 'strategy' performs under 'ordering'. ORDER_DEFAULT, or
+// a strategy without ordered variants, gives 'strategy->increment'.
+increment_fn_t strategy_increment(const increment_strategy_t* strategy, memory_ordering_t ordering);
+
+// Cache lines of counter state 'strategy' spans right now: 1 for a
+// single word, the cell count for the sharded counters.
+int strategy_footprint(const increment_strategy_t* strategy);
+
+// Increments applied per combiner pass in the last run of a combining
+// strategy; 0 for the others.
+double strategy_combining_degree(const increment_strategy_t* strategy);
+
+#endif // STRATEGIES_H
@@ -0,0 +1,171 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "timestamp.h"
+
+// False Sharing Stride Mode --------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * In complex mode the workers fight over one 'shared_data' because they
+ * really do share it. Here nobody shares anything: every worker
+ * increments a counter of its own, 'config->ops_per_thread' times. The
+ * only variable is how far apart the counters sit.
+ *
+ *   packed  adjacent ints, sixteen workers to a cache line
+ *   64      one line each, but the adjacent-line prefetcher on many x86
+ *           parts still fetches lines in 128 byte pairs
+ *   128     one prefetch pair each
+ *   page    nothing in common at all
+ *
+ * When two counters share a line, every increment has to pull the line
+ * away from the other core even though the data never overlaps. That is
+ * false sharing, and it can be as slow as the real thing. 'Slowdown'
+ * compares ns/op against the widest stride at the same thread count.
+ *
+ * The counters are 'volatile' so that every increment is a real load
+ * and store, like 'shared_data += 1', instead of one add at the end.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t released;
+  uint64_t finished;
+} stride_stamps_t;
+
+static barrier_wait_fn_t start_line;
+static long long ops_per_thread;
+static stride_stamps_t* stamps;
+
+static char* counters;   // Page aligned, 'max_threads * max_stride' bytes.
+static int stride;
+
+static void* stride_worker(void* id) {
+  int t = (intptr_t) id;
+  volatile int* counter = (volatile int*) (counters + (size_t) t * stride);
+
+  start_line(t);
+  stamps[t].released = ticks_now();
+
+  for (long long op = 0; op < ops_per_thread; op++) { *counter += 1; }
+
+  stamps[t].finished = ticks_now();
+  return NULL;
+}
+
+typedef struct {
+  double mops;
+  double ns_per_op;
+  bool   correct;     // Every counter ended at 'ops_per_thread'.
+} stride_result_t;
+
+static stride_result_t run_stride(const config_t* config, thread_pool_t* pool, int thread_count) {
+  stride_result_t result = { 0, 0, false };
+  if (barrier_arm(config->barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config->barrier->name, thread_count);
+    return result;
+  }
+
+  for (int t = 0; t < thread_count; t++) { *(int*) (counters + (size_t) t * stride) = 0; }
+  thread_pool_run(pool, thread_count, stride_worker);
+
+  uint64_t first_release = UINT64_MAX;
+  uint64_t last_finish = 0;
+  double busy_ns = 0;
+  result.correct = true;
+  for (int t = 0; t < thread_count; t++) {
+    if (stamps[t].released < first_release) { first_release = stamps[t].released; }
+    if (stamps[t].finished > last_finish)   { last_finish = stamps[t].finished; }
+    busy_ns += ticks_to_ns(stamps[t].finished - stamps[t].released);
+    if (*(int*) (counters + (size_t) t * stride) != (int) ops_per_thread) { result.correct = false; }
+  }
+
+  long long total = ops_per_thread * thread_count;
+  double elapsed_ns = ticks_to_ns(last_finish - first_release);
+  result.mops = elapsed_ns > 0 ? total / elapsed_ns * 1e3 : 0;
+  result.ns_per_op = busy_ns / total;
+  return result;
+}
+
+static void stride_name(int bytes, char* name, size_t size) {
+  if      (bytes == (int) sizeof(int))           { snprintf(name, size, "packed"); }
+  else if (bytes == (int) sysconf(_SC_PAGESIZE)) { snprintf(name, size, "page"); }
+  else                                           { snprintf(name, size, "%dB", bytes); }
+}
+
+void stride_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Stride Mode---------------------------\n");
+  table_printf("|Stride  |Thread_Count |   Ops/Thread |     Mops/s |    ns/op | Slowdown | Correct |\n");
+
+  int max_stride = 0;
+  int widest = 0;
+  for (int s = 0; s < config->stride_count; s++) {
+    if (config->strides[s] > max_stride) { max_stride = config->strides[s]; widest = s; }
+  }
+
+  long page = sysconf(_SC_PAGESIZE);
+  size_t bytes = ((size_t) config->max_threads * max_stride + page - 1) / page * page;
+  start_line = barrier_wait_fn(config->barrier, config->barrier_order);
+  ops_per_thread = config->ops_per_thread;
+  counters = aligned_alloc(page, bytes);
+  stamps = aligned_alloc(CACHE_LINE_SIZE, sizeof(stride_stamps_t) * config->max_threads);
+  stride_result_t* results = calloc(config->stride_count, sizeof(stride_result_t));
+  if (counters == NULL || stamps == NULL || results == NULL) {
+    fprintf(stderr, "Unable to allocate stride counters.\n");
+    free(counters);
+    free(stamps);
+    free(results);
+    return;
+  }
+  memset(counters, 0, bytes);
+
+  // Every stride at a given thread count runs back to back, so the
+  // slowdown compares like with like.
+  for (int c = 0; c < config->thread_count_len; c++) {
+    int thread_count = config->thread_counts[c];
+    for (int s = 0; s < config->stride_count; s++) {
+      stride = config->strides[s];
+      results[s] = run_stride(config, pool, thread_count);
+    }
+
+    for (int s = 0; s < config->stride_count; s++) {
+      char name[16];
+      stride_name(config->strides[s], name, sizeof(name));
+      double slowdown = results[widest].ns_per_op > 0 ? results[s].ns_per_op / results[widest].ns_per_op : 0;
+
+      table_printf("| %-6s | %10d  | %12lld | %10.2f | %8.2f | %7.2fx | %-7s |\n",
+                   name,
+                   thread_count,
+                   ops_per_thread,
+                   results[s].mops,
+                   results[s].ns_per_op,
+                   slowdown,
+                   results[s].correct ? "yes" : "NO");
+
+      report_field_t fields[] = {
+        REPORT_INT   ("stride_bytes",   config->strides[s]),
+        REPORT_INT   ("thread_count",   thread_count),
+        REPORT_INT   ("ops_per_thread", ops_per_thread),
+        REPORT_DOUBLE("mops",           results[s].mops),
+        REPORT_DOUBLE("ns_per_op",      results[s].ns_per_op),
+        REPORT_DOUBLE("slowdown",       slowdown),
+        REPORT_INT   ("correct",        results[s].correct),
+      };
+      report_row("stride", fields, sizeof(fields) / sizeof(fields[0]));
+    }
+  }
+
+  free(results);
+  free(stamps);
+  free(counters);
+  stamps = NULL;
+  counters = NULL;
+}
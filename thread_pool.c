@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+// 'assigned' is the generation of the last run handed to this worker;
+// it only ever moves when the worker is part of a run. 'parked' tells
+// the main thread that a futex wake is needed.
+struct pool_worker {
+  _Alignas(CACHE_LINE_SIZE) atomic_uint assigned;
+  atomic_bool parked;
+  thread_pool_t* pool;
+  int id;
+};
+
+// Waits until 'self->assigned' differs from 'seen': spins for a while,
+// then sleeps. Publishing 'parked' and re-reading 'assigned' pairs with
+// 'assign' storing 'assigned' and reading 'parked' (both seq_cst), so
+// one of the two always sees the other and no wake-up is lost.
+static unsigned wait_for_assignment(struct pool_worker* self, unsigned seen) {
+  unsigned spins = 0;
+  unsigned current;
+  while ((current = atomic_load_explicit(&self->assigned, memory_order_acquire)) == seen) {
+    if (++spins < SPIN_LIMIT) {
+      cpu_relax();
+      continue;
+    }
+    atomic_store(&self->parked, true);
+    if (atomic_load(&self->assigned) == seen) { futex_wait(&self->assigned, seen); }
+    atomic_store_explicit(&self->parked, false, memory_order_relaxed);
+  }
+  return current;
+}
+
+// Hands run 'generation' to 'worker'.
+static void assign(struct pool_worker* worker, unsigned generation) {
+  atomic_store(&worker->assigned, generation);
+  if (atomic_load(&worker->parked)) { futex_wake(&worker->assigned, 1); }
+}
+
+static void* pool_main(void* arg) {
+  struct pool_worker* self = arg;
+  thread_pool_t* pool = self->pool;
+  unsigned seen = 0;
+
+  for (;;) {
+    seen = wait_for_assignment(self, seen);
+    if (atomic_load_explicit(&pool->shutdown, memory_order_acquire)) { break; }
+
+    // 'routine' stays put until this worker has decremented 'pending'.
+    pool->routine((void*) (intptr_t) self->id);
+    atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_release);
+  }
+  return NULL;
+}
+
+// Pins the thread described by 'attr' to 'cpu'. Negative means unpinned.
+static void pin_attr_to_cpu(pthread_attr_t* attr, int cpu) {
+  if (cpu < 0) { return; }
+
+  cpu_set_t one;
+  CPU_ZERO(&one);
+  CPU_SET(cpu, &one);
+  pthread_attr_setaffinity_np(attr, sizeof(one), &one);
+}
+
+int thread_pool_create(thread_pool_t* pool, int capacity, const int* cpus) {
+  pool->capacity = 0;
+  pool->routine = NULL;
+  pool->generation = 0;
+  atomic_init(&pool->pending, 0);
+  atomic_init(&pool->shutdown, false);
+
+  pool->threads = calloc(capacity, sizeof(pthread_t));
+  pool->workers = calloc(capacity, sizeof(struct pool_worker));
+  if (pool->threads == NULL || pool->workers == NULL) {
+    free(pool->threads);
+    free(pool->workers);
+    return -1;
+  }
+
+  for (int t = 0; t < capacity; t++) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pin_attr_to_cpu(&attr, cpus != NULL ? cpus[t] : -1);
+
+    atomic_init(&pool->workers[t].assigned, 0);
+    atomic_init(&pool->workers[t].parked, false);
+    pool->workers[t].pool = pool;
+    pool->workers[t].id = t;
+    int err = pthread_create(&pool->threads[t], &attr, pool_main, &pool->workers[t]);
+    pthread_attr_destroy(&attr);
+
+    if (err != 0) {
+      thread_pool_destroy(pool);
+      return -1;
+    }
+    pool->capacity += 1;
+  }
+  return 0;
+}
+
+void thread_pool_run(thread_pool_t* pool, int active, pool_routine_t routine) {
+  if (active > pool->capacity) { active = pool->capacity; }
+
+  // The previous run waited for all of its workers, so nobody is
+  // reading 'routine' right now.
+  pool->routine = routine;
+  pool->generation += 1;
+  atomic_store_explicit(&pool->pending, active, memory_order_relaxed);
+
+  // Each seq_cst store of 'assigned' also releases 'routine' and
+  // 'pending' to the worker that observes it.
+  for (int w = 0; w < active; w++) { assign(&pool->workers[w], pool->generation); }
+
+  unsigned spins = 0;
+  while (atomic_load_explicit(&pool->pending, memory_order_acquire) != 0) {
+    spin_pause(&spins);
+  }
+}
+
+void thread_pool_destroy(thread_pool_t* pool) {
+  atomic_store_explicit(&pool->shutdown, true, memory_order_release);
+  pool->generation += 1;
+  for (int w = 0; w < pool->capacity; w++) { assign(&pool->workers[w], pool->generation); }
+
+  for (int t = 0; t < pool->capacity; t++) {
+    pthread_join(pool->threads[t], NULL);
+  }
+
+  free(pool->threads);
+  free(pool->workers);
+  pool->threads = NULL;
+  pool->workers = NULL;
+  pool->capacity = 0;
+}
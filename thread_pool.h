@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "platform.h"
+
+// Persistent Worker Pool -----------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Creating a thread costs tens of microseconds while the experiment
+ * we run on it costs a handful of nanoseconds. The pool spawns its
+ * workers once, optionally pins each one to a CPU, and then parks
+ * them until 'thread_pool_run' re-arms them with a routine. A worker
+ * spins briefly after each run, so back-to-back runs wake it quickly,
+ * and then sleeps on a futex so that it does not compete with the
+ * workers that are running. Each run hands the
+ * routine the worker's index, cast to 'void*', exactly as if it had
+ * been passed to 'pthread_create'. That way the same 'worker' function
+ * serves both the pool and the classic fork-join path.
+ */
+
+typedef void* (*pool_routine_t)(void*);
+
+struct pool_worker;
+
+typedef struct {
+  int capacity;                 // Number of live worker threads.
+  pthread_t* threads;
+  struct pool_worker* workers;
+
+  // Written by the main thread before it hands out a run, and only once
+  // every worker of the previous run has finished with it.
+  pool_routine_t routine;
+  unsigned generation;          // Number of the last run handed out.
+
+  // Each run is handed to workers 0..active-1 alone, by storing its
+  // generation in their own slot. Idle workers are never woken. Every
+  // worker of the run decrements 'pending' when it is done.
+  _Alignas(CACHE_LINE_SIZE) atomic_int pending;
+  atomic_bool shutdown;
+} thread_pool_t;
+
+// Spawns 'capacity' workers. Worker n is pinned to 'cpus[n]' unless
+// 'cpus' is NULL or the entry is negative. Returns 0 on success.
+int  thread_pool_create(thread_pool_t* pool, int capacity, const int* cpus);
+
+// Runs 'routine' on workers 0..active-1 and waits for them to finish.
+void thread_pool_run(thread_pool_t* pool, int active, pool_routine_t routine);
+
+// Wakes, joins, and frees every worker.
+void thread_pool_destroy(thread_pool_t* pool);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,383 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "perf_counters.h"
+#include "platform.h"
+#include "report.h"
+#include "stats.h"
+#include "strategies.h"
+#include "timestamp.h"
+
+// Throughput Mode ------------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Complex mode asks whether one increment per thread survives. This
+ * mode asks how fast the counter goes when every worker hammers it with
+ * 'config->ops_per_thread' increments in a row. The run starts when the
+ * first worker leaves the barrier and ends when the last one finishes.
+ *
+ *   Mops/s      total increments / run time
+ *   ns/op       average time a worker spent per increment
+ *   Efficiency  Mops/s(N) / (N * Mops/s(1)); 100% is perfect scaling
+ *   Lost %      increments that did not make it into the final value
+ *   Cells       cache lines of counter state at the end of the run; only
+ *               the sharded and adaptive counters use more than one
+ *
+ * After the sweep every strategy's Mops/s is fitted to Amdahl's law and
+ * to the Universal Scalability Law (see stats.h). Sigma, kappa and the
+ * peak they predict fingerprint how a strategy scales in a few numbers
+ * that can be compared across machines; the residuals say whether the
+ * model fits at all. A fit needs one thread count above one for Amdahl
+ * and two for the USL.
+ *
+ * With '--perf' the table goes on with hardware counters per increment
+ * (see perf_counters.h), read by each worker around its loop.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) uint64_t released;
+  uint64_t finished;
+  perf_sample_t perf_before;
+  perf_sample_t perf_after;
+} throughput_stamps_t;
+
+static const increment_strategy_t* strategy;
+static increment_fn_t increment;            // 'strategy' at the ordering under test.
+static const barrier_algorithm_t* start_barrier;
+static barrier_wait_fn_t start_line;       // 'start_barrier' at the ordering under test.
+static long long ops_per_thread;
+static throughput_stamps_t* stamps;
+static bool count_events;
+
+static void* throughput_worker(void* id) {
+  int t = (intptr_t) id;
+  if (count_events) { perf_counters_attach(t); }
+  start_line(t);
+  stamps[t].released = ticks_now();
+  if (count_events) { perf_counters_read(t, &stamps[t].perf_before); }
+
+  for (long long op = 0; op < ops_per_thread; op++) { increment(t); }
+
+  if (count_events) { perf_counters_read(t, &stamps[t].perf_after); }
+  stamps[t].finished = ticks_now();
+  return NULL;
+}
+
+typedef struct {
+  double mops;
+  double ns_per_op;
+  double lost_percent;
+  int    cells;
+  perf_sample_t perf;        // Summed over all workers.
+} throughput_result_t;
+
+static throughput_result_t run_throughput(thread_pool_t* pool, int thread_count) {
+  throughput_result_t result;
+  memset(&result, 0, sizeof(result));
+  if (barrier_arm(start_barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", start_barrier->name, thread_count);
+    return result;
+  }
+
+  strategy->reset();
+  thread_pool_run(pool, thread_count, throughput_worker);
+
+  uint64_t first_release = UINT64_MAX;
+  uint64_t last_finish = 0;
+  double busy_ns = 0;
+  for (int t = 0; t < thread_count; t++) {
+    if (stamps[t].released < first_release) { first_release = stamps[t].released; }
+    if (stamps[t].finished > last_finish)   { last_finish = stamps[t].finished; }
+    busy_ns += ticks_to_ns(stamps[t].finished - stamps[t].released);
+    if (count_events) { perf_sample_accumulate(&result.perf, &stamps[t].perf_before, &stamps[t].perf_after); }
+  }
+
+  long long expected = ops_per_thread * thread_count;
+  double elapsed_ns = ticks_to_ns(last_finish - first_release);
+
+  // The int based counters wrap long before 'expected' does. Comparing
+  // modulo 2^32 gives the exact loss as long as fewer than 2^32
+  // increments went missing.
+  uint32_t lost = (uint32_t) expected - (uint32_t) strategy->read();
+
+  result.mops = elapsed_ns > 0 ? expected / elapsed_ns * 1e3 : 0;
+  result.ns_per_op = busy_ns / expected;
+  result.lost_percent = 100.0 * lost / expected;
+  result.cells = strategy_footprint(strategy);
+  return result;
+}
+
+static int setup_throughput(const config_t* config) {
+  start_barrier = config->barrier;
+  ops_per_thread = config->ops_per_thread;
+  count_events = config->perf_counters;
+  stamps = aligned_alloc(CACHE_LINE_SIZE, sizeof(throughput_stamps_t) * config->max_threads);
+  if (stamps == NULL) {
+    fprintf(stderr, "Unable to allocate throughput timestamps.\n");
+    return -1;
+  }
+  return 0;
+}
+
+static void print_fit(const char* name, const char* model, const scalability_fit_t* fit, bool fitted) {
+  if (!fitted) {
+    table_printf("| %-8s | %-6s | %8s | %10s | %7s | %11s | %9s | %9s |\n", name, model, "-", "-", "-", "-", "-", "-");
+    return;
+  }
+  table_printf("| %-8s | %-6s | %8.5f | %10.3e |", name, model, fit->sigma, fit->kappa);
+  if (isinf(fit->peak_threads)) { table_printf(" %7s |", "inf"); }
+  else                          { table_printf(" %7.1f |", fit->peak_threads); }
+  if (isinf(fit->peak_throughput)) { table_printf(" %11s |", "inf"); }
+  else                             { table_printf(" %11.2f |", fit->peak_throughput); }
+  table_printf(" %8.2f%% | %8.2f%% |\n", 100.0 * fit->rms_residual, 100.0 * fit->max_residual);
+}
+
+static void report_fit(const char* name, const char* model, const scalability_fit_t* fit) {
+  report_field_t fields[] = {
+    REPORT_STRING("strategy",             name),
+    REPORT_STRING("model",                model),
+    REPORT_INT   ("points",               fit->points),
+    REPORT_DOUBLE("sigma",                fit->sigma),
+    REPORT_DOUBLE("kappa",                fit->kappa),
+    REPORT_DOUBLE("peak_threads",         isinf(fit->peak_threads) ? 0.0 : fit->peak_threads),
+    REPORT_DOUBLE("peak_mops",            isinf(fit->peak_throughput) ? 0.0 : fit->peak_throughput),
+    REPORT_DOUBLE("rms_residual_percent", 100.0 * fit->rms_residual),
+    REPORT_DOUBLE("max_residual_percent", 100.0 * fit->max_residual),
+  };
+  report_row("scalability", fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+// One Amdahl and one USL row per strategy. 'mops' holds the sweep of
+// strategy s at 'mops[s * thread_count_len + c]'.
+static void print_scalability(const config_t* config, const double* baselines, const double* mops) {
+  table_printf("\n");
+  table_printf("Scalability Fit-----------------------\n");
+  table_printf("|Strategy  | Model  |    Sigma |      Kappa |  Peak N | Peak Mops/s | RMS Resid | Max Resid |\n");
+
+  for (int s = 0; s < config->strategy_count; s++) {
+    const char* name = config->strategies[s]->name;
+    const double* sweep = mops + (size_t) s * config->thread_count_len;
+    scalability_fit_t amdahl, usl;
+    bool have_amdahl = scalability_fit(config->thread_counts, sweep, config->thread_count_len,
+                                       baselines[s], false, &amdahl) == 0;
+    bool have_usl = scalability_fit(config->thread_counts, sweep, config->thread_count_len,
+                                    baselines[s], true, &usl) == 0;
+    print_fit(name, "amdahl", &amdahl, have_amdahl);
+    print_fit(name, "usl", &usl, have_usl);
+    if (have_amdahl) { report_fit(name, "amdahl", &amdahl); }
+    if (have_usl)    { report_fit(name, "usl", &usl); }
+  }
+}
+
+void throughput_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Throughput Mode-----------------------\n");
+  table_printf("|Strategy  |Thread_Count |   Ops/Thread |     Mops/s |    ns/op | Efficiency |  Lost %% | Cells |");
+  if (config->perf_counters) { perf_print_header(); }
+  table_printf("\n");
+
+  if (setup_throughput(config) != 0) { return; }
+  start_line = barrier_wait_fn(start_barrier, config->barrier_order);
+
+  // Kept for the scalability fit at the end.
+  double* baselines = calloc(config->strategy_count, sizeof(double));
+  double* mops = calloc((size_t) config->strategy_count * config->thread_count_len, sizeof(double));
+
+  for (int s = 0; s < config->strategy_count; s++) {
+    strategy = config->strategies[s];
+    increment = strategy_increment(strategy, config->increment_order);
+
+    // Efficiency is relative to one thread, whether or not one thread is
+    // part of the sweep.
+    throughput_result_t baseline = run_throughput(pool, 1);
+    baselines[s] = baseline.mops;
+
+    for (int c = 0; c < config->thread_count_len; c++) {
+      int thread_count = config->thread_counts[c];
+      throughput_result_t result = thread_count == 1 ? baseline : run_throughput(pool, thread_count);
+      double efficiency = baseline.mops > 0 ? 100.0 * result.mops / (thread_count * baseline.mops) : 0;
+      mops[(size_t) s * config->thread_count_len + c] = result.mops;
+
+      table_printf("| %-8s | %10d  | %12lld | %10.2f | %8.2f | %9.1f%% | %7.3f | %5d |",
+                   strategy->name,
+                   thread_count,
+                   ops_per_thread,
+                   result.mops,
+                   result.ns_per_op,
+                   efficiency,
+                   result.lost_percent,
+                   result.cells);
+      if (config->perf_counters) { perf_print_values(&result.perf, (double) ops_per_thread * thread_count); }
+      table_printf("\n");
+
+      report_field_t fields[] = {
+        REPORT_STRING("strategy",           strategy->name),
+        REPORT_INT   ("thread_count",       thread_count),
+        REPORT_INT   ("ops_per_thread",     ops_per_thread),
+        REPORT_DOUBLE("mops",               result.mops),
+        REPORT_DOUBLE("ns_per_op",          result.ns_per_op),
+        REPORT_DOUBLE("efficiency_percent", efficiency),
+        REPORT_DOUBLE("lost_percent",       result.lost_percent),
+        REPORT_INT   ("cells",              result.cells),
+      };
+
+      int count = sizeof(fields) / sizeof(fields[0]);
+      report_field_t all[sizeof(fields) / sizeof(fields[0]) + PERF_EVENT_COUNT];
+      memcpy(all, fields, sizeof(fields));
+      if (config->perf_counters) {
+        count += perf_report_fields(&result.perf, (double) ops_per_thread * thread_count, all + count);
+      }
+      report_row("throughput", all, count);
+    }
+  }
+
+  print_scalability(config, baselines, mops);
+  free(mops);
+  free(baselines);
+  free(stamps);
+  stamps = NULL;
+}
+
+// Memory Ordering Sweep ------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The throughput run again, for every strategy that has ordered
+ * variants, at every increment ordering crossed with every ordering of
+ * the start line. 'vs seq_cst' is Mops/s relative to a seq_cst
+ * increment with the same start line. 'Lost %' shows whether the
+ * weaker ordering broke anything: for a bare counter it never should,
+ * for the spinlock it may on weakly ordered machines.
+ */
+
+void ordering_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Ordering Mode-------------------------\n");
+  table_printf("|Strategy  | Order           | Barrier Order   |Thread_Count |     Mops/s |    ns/op | vs seq_cst |  Lost %% |\n");
+
+  if (setup_throughput(config) != 0) { return; }
+
+  // A start line without ordered variants is only run as written.
+  int barrier_orders = start_barrier->ordered_wait != NULL ? ORDER_COUNT : 1;
+
+  for (int c = 0; c < config->thread_count_len; c++) {
+    int thread_count = config->thread_counts[c];
+
+    for (int s = 0; s < config->strategy_count; s++) {
+      strategy = config->strategies[s];
+      if (strategy->ordered == NULL) { continue; }
+
+      for (int b = 0; b < barrier_orders; b++) {
+        memory_ordering_t barrier_order = barrier_orders == 1 ? ORDER_DEFAULT : (memory_ordering_t) b;
+        start_line = barrier_wait_fn(start_barrier, barrier_order);
+
+        throughput_result_t results[ORDER_COUNT];
+        for (int o = 0; o < ORDER_COUNT; o++) {
+          increment = strategy_increment(strategy, (memory_ordering_t) o);
+          results[o] = run_throughput(pool, thread_count);
+        }
+
+        for (int o = 0; o < ORDER_COUNT; o++) {
+          double relative = results[ORDER_SEQ_CST].mops > 0 ? results[o].mops / results[ORDER_SEQ_CST].mops : 0;
+          table_printf("| %-8s | %-15s | %-15s | %10d  | %10.2f | %8.2f | %9.2fx | %7.3f |\n",
+                       strategy->name,
+                       ordering_name((memory_ordering_t) o),
+                       ordering_name(barrier_order),
+                       thread_count,
+                       results[o].mops,
+                       results[o].ns_per_op,
+                       relative,
+                       results[o].lost_percent);
+
+          report_field_t fields[] = {
+            REPORT_STRING("strategy",            strategy->name),
+            REPORT_STRING("swept_order",         ordering_name((memory_ordering_t) o)),
+            REPORT_STRING("swept_barrier_order", ordering_name(barrier_order)),
+            REPORT_INT   ("thread_count",        thread_count),
+            REPORT_INT   ("ops_per_thread",      ops_per_thread),
+            REPORT_DOUBLE("mops",                results[o].mops),
+            REPORT_DOUBLE("ns_per_op",           results[o].ns_per_op),
+            REPORT_DOUBLE("vs_seq_cst",          relative),
+            REPORT_DOUBLE("lost_percent",        results[o].lost_percent),
+          };
+          report_row("ordering", fields, sizeof(fields) / sizeof(fields[0]));
+        }
+      }
+    }
+  }
+
+  free(stamps);
+  stamps = NULL;
+}
+
+// Combining Crossover --------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Flat combining pays a lock and a scan of every slot per pass, which
+ * only pays off once enough increments arrive per pass to beat one
+ * 'lock xadd' each. This runs 'atomic' and 'combiner' back to back at
+ * every thread count and reports where, if anywhere in the sweep,
+ * combining pulls ahead.
+ *
+ *   Degree   increments applied per combiner pass
+ *   Speedup  combiner Mops/s over atomic Mops/s
+ */
+
+void combining_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Combining Mode------------------------\n");
+  table_printf("|Thread_Count | atomic Mops/s | combiner Mops/s |   Degree |  Speedup |\n");
+
+  if (setup_throughput(config) != 0) { return; }
+  start_line = barrier_wait_fn(start_barrier, config->barrier_order);
+
+  const increment_strategy_t* atomic = find_strategy("atomic");
+  const increment_strategy_t* combiner = find_strategy("combiner");
+  int crossover = 0;
+
+  for (int c = 0; c < config->thread_count_len; c++) {
+    int thread_count = config->thread_counts[c];
+
+    strategy = atomic;
+    increment = strategy_increment(atomic, config->increment_order);
+    throughput_result_t hardware = run_throughput(pool, thread_count);
+
+    strategy = combiner;
+    increment = combiner->increment;
+    throughput_result_t combined = run_throughput(pool, thread_count);
+    double degree = strategy_combining_degree(combiner);
+
+    double speedup = hardware.mops > 0 ? combined.mops / hardware.mops : 0;
+    if (speedup > 1 && crossover == 0) { crossover = thread_count; }
+
+    table_printf("| %10d  | %13.2f | %15.2f | %8.2f | %7.2fx |\n",
+                 thread_count,
+                 hardware.mops,
+                 combined.mops,
+                 degree,
+                 speedup);
+
+    report_field_t fields[] = {
+      REPORT_INT   ("thread_count",   thread_count),
+      REPORT_INT   ("ops_per_thread", ops_per_thread),
+      REPORT_DOUBLE("atomic_mops",    hardware.mops),
+      REPORT_DOUBLE("combiner_mops",  combined.mops),
+      REPORT_DOUBLE("degree",         degree),
+      REPORT_DOUBLE("speedup",        speedup),
+    };
+    report_row("combining", fields, sizeof(fields) / sizeof(fields[0]));
+  }
+
+  if (crossover > 0) { table_printf("Combining first beats fetch-add at %d threads.\n", crossover); }
+  else               { table_printf("Combining never beats fetch-add in this sweep.\n"); }
+
+  free(stamps);
+  stamps = NULL;
+}
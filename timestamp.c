@@ -0,0 +1,24 @@
+#include "platform.h"
+#include "timestamp.h"
+
+// How long calibration watches the tick counter. Long enough for the
+// clock read overhead to vanish in the noise, short enough not to
+// notice at start-up.
+#define CALIBRATION_NS 20000000LL
+
+static double ns_per_tick = 1.0;
+
+void calibrate_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  long long start_ns = now_ns();
+  uint64_t start_ticks = ticks_now();
+
+  long long elapsed_ns;
+  do { elapsed_ns = now_ns() - start_ns; } while (elapsed_ns < CALIBRATION_NS);
+  uint64_t elapsed_ticks = ticks_now() - start_ticks;
+
+  if (elapsed_ticks > 0) { ns_per_tick = (double) elapsed_ns / elapsed_ticks; }
+#endif
+}
+
+double ticks_to_ns(uint64_t ticks) { return ticks * ns_per_tick; }
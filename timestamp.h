@@ -0,0 +1,37 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <stdint.h>
+#include <time.h>
+
+// High Resolution Timestamps -------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * 'now_ns()' goes through the vDSO and costs ~20ns, which is longer
+ * than the increment we are trying to observe. On x86 we read the time
+ * stamp counter directly instead. 'rdtscp' waits for every earlier
+ * instruction to finish, so a stamp taken after the increment really is
+ * after it. The TSC is assumed to be invariant and synchronised across
+ * cores, which holds for every x86 part of the last decade. Elsewhere
+ * we fall back to CLOCK_MONOTONIC_RAW and a tick is one nanosecond.
+ */
+
+static inline uint64_t ticks_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned aux;
+  return __builtin_ia32_rdtscp(&aux);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Measures the tick rate against the monotonic clock. Call once before
+// converting ticks; until then a tick counts as one nanosecond.
+void calibrate_ticks(void);
+
+double ticks_to_ns(uint64_t ticks);
+
+#endif // TIMESTAMP_H
@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "topology.h"
+
+int online_cpu_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int) count : 1;
+}
+
+static const char* pin_policy_names[] = {
+  [PIN_NONE]        = "none",
+  [PIN_ROUND_ROBIN] = "round-robin",
+  [PIN_COMPACT]     = "compact",
+  [PIN_SCATTER]     = "scatter",
+  [PIN_SMT_FIRST]   = "smt-first",
+  [PIN_PER_CORE]    = "per-core",
+  [PIN_SAME_LLC]    = "same-llc",
+  [PIN_CROSS_LLC]   = "cross-llc",
+};
+
+static const char* pin_policy_descriptions[] = {
+  [PIN_NONE]        = "leave placement to the scheduler",
+  [PIN_ROUND_ROBIN] = "worker n on the n-th allowed CPU",
+  [PIN_COMPACT]     = "fill one LLC a core at a time, then the SMT siblings",
+  [PIN_SCATTER]     = "spread over packages, LLCs and cores before siblings",
+  [PIN_SMT_FIRST]   = "both SMT siblings of a core before the next core",
+  [PIN_PER_CORE]    = "one worker per physical core, siblings idle",
+  [PIN_SAME_LLC]    = "only CPUs sharing the first allowed CPU's LLC",
+  [PIN_CROSS_LLC]   = "consecutive workers on different LLCs",
+};
+
+const int pin_policy_count = sizeof(pin_policy_names) / sizeof(pin_policy_names[0]);
+
+int parse_pin_policy(const char* name, pin_policy_t* policy) {
+  for (int p = 0; p < pin_policy_count; p++) {
+    if (strcmp(pin_policy_names[p], name) == 0) {
+      *policy = (pin_policy_t) p;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char* pin_policy_name(pin_policy_t policy) { return pin_policy_names[policy]; }
+
+const char* pin_policy_description(pin_policy_t policy) { return pin_policy_descriptions[policy]; }
+
+int allowed_cpus(int* cpus, int max) {
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) { return 0; }
+
+  int found = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE && found < max; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) { cpus[found++] = cpu; }
+  }
+  return found;
+}
+
+// Reading the Topology -------------------------------------------
+//-----------------------------------------------------------------
+
+// Where one CPU sits. LLCs and cores are named after their lowest CPU,
+// which unlike sysfs' 'core_id' is unique across packages.
+typedef struct {
+  int cpu;
+  int package;
+  int llc;
+  int core;
+  int thread;      // Rank among the core's allowed SMT siblings; 0 is the first.
+  int llc_rank;    // Rank of 'llc' among the LLCs of 'package'.
+  int core_rank;   // Rank of 'core' among the cores of 'llc'.
+} cpu_place_t;
+
+static int read_sysfs_int(const char* path, int fallback) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) { return fallback; }
+  int value;
+  if (fscanf(file, "%d", &value) != 1) { value = fallback; }
+  fclose(file);
+  return value;
+}
+
+// Reads a cpulist such as "0-3,8,10-11" and reports its lowest CPU.
+// Returns -1 if unreadable.
+static int read_lowest_cpu(const char* path, int* lowest) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) { return -1; }
+  char text[4096];
+  bool ok = fgets(text, sizeof(text), file) != NULL;
+  fclose(file);
+  if (!ok) { return -1; }
+
+  *lowest = -1;
+  char* saveptr = NULL;
+  for (char* range = strtok_r(text, ",\n", &saveptr); range != NULL; range = strtok_r(NULL, ",\n", &saveptr)) {
+    int first;
+    if (sscanf(range, "%d", &first) != 1) { continue; }
+    if (*lowest < 0 || first < *lowest) { *lowest = first; }
+  }
+  return *lowest >= 0 ? 0 : -1;
+}
+
+// The highest level cache listed for 'cpu' is its LLC.
+static int read_llc(int cpu) {
+  int best_level = 0;
+  int llc = 0;
+  for (int index = 0; ; index++) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+    int level = read_sysfs_int(path, -1);
+    if (level < 0) { break; }
+    if (level <= best_level) { continue; }
+
+    int lowest;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+    if (read_lowest_cpu(path, &lowest) == 0) {
+      best_level = level;
+      llc = lowest;
+    }
+  }
+  return llc;
+}
+
+static void read_place(int cpu, cpu_place_t* place) {
+  char path[128];
+  place->cpu = cpu;
+
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+  place->package = read_sysfs_int(path, 0);
+
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  if (read_lowest_cpu(path, &place->core) != 0) { place->core = cpu; }
+
+  place->llc = read_llc(cpu);
+}
+
+// Sets 'ranks[p]' to the number of distinct values of 'key' below that
+// of place p among the places in the same group as p.
+static void rank_within(const cpu_place_t* places, int count, int* ranks,
+                        int (*key)(const cpu_place_t*), bool (*same_group)(const cpu_place_t*, const cpu_place_t*)) {
+  // Only the first place with each value in each group is counted.
+  bool* first = calloc(count, sizeof(bool));
+  for (int p = 0; p < count; p++) {
+    first[p] = true;
+    for (int q = 0; q < p && first[p]; q++) {
+      first[p] = !(same_group(&places[q], &places[p]) && key(&places[q]) == key(&places[p]));
+    }
+  }
+
+  for (int p = 0; p < count; p++) {
+    ranks[p] = 0;
+    for (int q = 0; q < count; q++) {
+      if (first[q] && same_group(&places[q], &places[p]) && key(&places[q]) < key(&places[p])) { ranks[p] += 1; }
+    }
+  }
+  free(first);
+}
+
+static int cpu_of(const cpu_place_t* place)  { return place->cpu; }
+static int llc_of(const cpu_place_t* place)  { return place->llc; }
+static int core_of(const cpu_place_t* place) { return place->core; }
+static bool same_package(const cpu_place_t* a, const cpu_place_t* b) { return a->package == b->package; }
+static bool same_llc(const cpu_place_t* a, const cpu_place_t* b)     { return a->llc == b->llc; }
+static bool same_core(const cpu_place_t* a, const cpu_place_t* b)    { return a->core == b->core; }
+
+// Placement Policies ---------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * Every policy is a sort order over the allowed CPUs, optionally
+ * restricted to a subset. Sorting on (siblings, core, LLC) spreads
+ * workers out; sorting on (LLC, core, siblings) packs them together.
+ */
+
+#define SORT_KEYS 4
+
+static pin_policy_t sort_policy;
+
+static void sort_key(const cpu_place_t* p, int key[SORT_KEYS]) {
+  switch (sort_policy) {
+    case PIN_COMPACT:   key[0] = p->package; key[1] = p->llc_rank;  key[2] = p->thread;    key[3] = p->core_rank; break;
+    case PIN_SMT_FIRST: key[0] = p->package; key[1] = p->llc_rank;  key[2] = p->core_rank; key[3] = p->thread;    break;
+    case PIN_PER_CORE:  key[0] = p->package; key[1] = p->llc_rank;  key[2] = p->core_rank; key[3] = 0;            break;
+    case PIN_SCATTER:   key[0] = p->thread;  key[1] = p->core_rank; key[2] = p->llc_rank;  key[3] = p->package;  break;
+    case PIN_SAME_LLC:  key[0] = p->thread;  key[1] = p->core_rank; key[2] = 0;            key[3] = 0;            break;
+    case PIN_CROSS_LLC: key[0] = p->thread;  key[1] = p->core_rank; key[2] = p->llc;       key[3] = 0;            break;
+    default:            key[0] = 0;          key[1] = 0;            key[2] = 0;            key[3] = 0;            break;
+  }
+}
+
+static int compare_places(const void* a, const void* b) {
+  int x[SORT_KEYS], y[SORT_KEYS];
+  sort_key(a, x);
+  sort_key(b, y);
+  for (int k = 0; k < SORT_KEYS; k++) {
+    if (x[k] != y[k]) { return x[k] < y[k] ? -1 : 1; }
+  }
+  return ((const cpu_place_t*) a)->cpu - ((const cpu_place_t*) b)->cpu;
+}
+
+int placement_cpus(pin_policy_t policy, int count, int* cpus) {
+  for (int w = 0; w < count; w++) { cpus[w] = -1; }
+  if (policy == PIN_NONE) { return 0; }
+
+  int allowed[CPU_SETSIZE];
+  int available = allowed_cpus(allowed, CPU_SETSIZE);
+  if (available == 0) { return -1; }
+
+  if (policy == PIN_ROUND_ROBIN) {
+    for (int w = 0; w < count; w++) { cpus[w] = allowed[w % available]; }
+    return 0;
+  }
+
+  cpu_place_t* places = calloc(available, sizeof(cpu_place_t));
+  int* threads = calloc(available, sizeof(int));
+  int* llc_ranks = calloc(available, sizeof(int));
+  int* core_ranks = calloc(available, sizeof(int));
+  if (places == NULL || threads == NULL || llc_ranks == NULL || core_ranks == NULL) {
+    free(places); free(threads); free(llc_ranks); free(core_ranks);
+    return -1;
+  }
+
+  for (int p = 0; p < available; p++) { read_place(allowed[p], &places[p]); }
+  rank_within(places, available, threads,    cpu_of,  same_core);
+  rank_within(places, available, llc_ranks,  llc_of,  same_package);
+  rank_within(places, available, core_ranks, core_of, same_llc);
+
+  // Fill in the ranks and drop the CPUs the policy does not use.
+  int first_llc = places[0].llc;
+  int kept = 0;
+  for (int p = 0; p < available; p++) {
+    places[p].thread = threads[p];
+    places[p].llc_rank = llc_ranks[p];
+    places[p].core_rank = core_ranks[p];
+    if (policy == PIN_PER_CORE && places[p].thread != 0)     { continue; }
+    if (policy == PIN_SAME_LLC && places[p].llc != first_llc) { continue; }
+    places[kept++] = places[p];
+  }
+  free(threads);
+  free(llc_ranks);
+  free(core_ranks);
+
+  sort_policy = policy;
+  qsort(places, kept, sizeof(cpu_place_t), compare_places);
+  for (int w = 0; w < count; w++) { cpus[w] = places[w % kept].cpu; }
+
+  free(places);
+  return 0;
+}
+
+int pin_current_thread(int cpu) {
+  if (cpu < 0) { return 0; }
+
+  cpu_set_t one;
+  CPU_ZERO(&one);
+  CPU_SET(cpu, &one);
+  return pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+}
@@ -0,0 +1,57 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+// CPU Topology and Worker Placement ------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * What a lost update costs depends on how far the cache line has to
+ * travel: between SMT siblings it never leaves the core, inside one
+ * last level cache (LLC) it crosses the ring or mesh, and between LLCs
+ * or sockets it crosses the interconnect. The policies below decide
+ * which of those distances the workers are spread over. The topology
+ * comes from /sys/devices/system/cpu and only CPUs in the process
+ * affinity mask are used. Where sysfs is missing every CPU counts as
+ * its own core in a single package and LLC.
+ *
+ * When a policy offers fewer CPUs than there are workers, the workers
+ * wrap around and share.
+ */
+
+// How workers are mapped onto CPUs.
+typedef enum {
+  PIN_NONE,          // Let the scheduler place workers wherever it likes.
+  PIN_ROUND_ROBIN,   // Worker n runs on the n-th allowed CPU, wrapping.
+  PIN_COMPACT,       // Fill one LLC, a core at a time, then its SMT siblings.
+  PIN_SCATTER,       // Spread over packages, then LLCs, then cores, then siblings.
+  PIN_SMT_FIRST,     // Both siblings of a core before moving to the next core.
+  PIN_PER_CORE,      // One worker per physical core, siblings left idle.
+  PIN_SAME_LLC,      // Only the CPUs sharing the first allowed CPU's LLC.
+  PIN_CROSS_LLC,     // Consecutive workers on different LLCs.
+} pin_policy_t;
+
+// Number of CPUs currently online.
+int online_cpu_count(void);
+
+// Collects up to 'max' CPUs this process is allowed to run on, in
+// ascending order. Returns how many it found.
+int allowed_cpus(int* cpus, int max);
+
+// Parses a policy name ("none", "round-robin", "compact", ...).
+// Returns 0 on success.
+int parse_pin_policy(const char* name, pin_policy_t* policy);
+const char* pin_policy_name(pin_policy_t policy);
+
+// One line summary of a policy, for the usage text.
+const char* pin_policy_description(pin_policy_t policy);
+extern const int pin_policy_count;
+
+// Fills 'cpus[0..count-1]' with the CPU each worker should be pinned to,
+// or -1 for "do not pin". Returns 0 on success.
+int placement_cpus(pin_policy_t policy, int count, int* cpus);
+
+// Pins the calling thread to 'cpu'. Negative means leave it alone.
+// Returns 0 on success.
+int pin_current_thread(int cpu);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,204 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "barrier.h"
+#include "modes.h"
+#include "platform.h"
+#include "report.h"
+#include "timestamp.h"
+
+// Race Window Mode -----------------------------------------------
+//-----------------------------------------------------------------
+
+/*
+ * The comment in 'worker' walks through why 'shared_data += 1' loses
+ * updates: two threads can both load before either stores. The window
+ * for that is three instructions wide, so at low thread counts a lost
+ * update is rare and it takes a great many experiments to see one.
+ *
+ * This mode pries the window open. Each worker loads the counter, waits,
+ * and stores the value plus one, so the window is as wide as the wait.
+ * The wait is one of
+ *
+ *   pause  N 'pause' instructions (see 'cpu_relax')
+ *   loop   N iterations of an empty loop on a volatile counter
+ *   miss   N dependent loads chasing pointers through a buffer far
+ *          larger than the caches, so each one is a miss to DRAM
+ *
+ * for every N in 'config->windows', with 'config->experiments' single
+ * increments per worker at each point. 'Window' is the wait measured on
+ * its own, on one thread. P(lost) is the fraction of experiments that
+ * lost at least one update; plotted against the window it shows how
+ * fast the risk grows as a critical section gets wider.
+ */
+
+typedef enum {
+  DELAY_PAUSE,
+  DELAY_LOOP,
+  DELAY_MISS,
+  DELAY_COUNT,
+} delay_kind_t;
+
+static const char* delay_names[DELAY_COUNT] = { "pause", "loop", "miss" };
+
+// One line of the pointer chase. 'next' is a line index.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) size_t next;
+} chase_line_t;
+
+#define CHASE_BYTES (64 << 20)
+#define CHASE_LINES (CHASE_BYTES / sizeof(chase_line_t))
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) size_t cursor;   // Where this worker's chase stands.
+} chase_cursor_t;
+
+static chase_line_t* chase;
+static chase_cursor_t* cursors;
+
+static barrier_wait_fn_t start_line;
+static delay_kind_t delay_kind;
+static int delay_length;
+
+static _Alignas(CACHE_LINE_SIZE) volatile int window_data;
+
+// Links every line into one random cycle (Sattolo's algorithm), so the
+// prefetchers cannot guess the next line.
+static void build_chase(void) {
+  for (size_t l = 0; l < CHASE_LINES; l++) { chase[l].next = l; }
+  uint64_t random = 88172645463325252ULL;
+  for (size_t l = CHASE_LINES - 1; l > 0; l--) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    size_t other = random % l;
+    size_t swap = chase[l].next;
+    chase[l].next = chase[other].next;
+    chase[other].next = swap;
+  }
+}
+
+static void delay(int t) {
+  switch (delay_kind) {
+    case DELAY_PAUSE:
+      for (int i = 0; i < delay_length; i++) { cpu_relax(); }
+      break;
+    case DELAY_LOOP:
+      for (volatile int i = 0; i < delay_length; i++) {}
+      break;
+    case DELAY_MISS: {
+      size_t cursor = cursors[t].cursor;
+      for (int i = 0; i < delay_length; i++) { cursor = chase[cursor].next; }
+      cursors[t].cursor = cursor;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void* window_worker(void* id) {
+  int t = (intptr_t) id;
+  start_line(t);
+
+  int value = window_data;
+  delay(t);
+  window_data = value + 1;
+  return NULL;
+}
+
+// Mean length of the current delay on the calling thread, in ns.
+static double measure_window(int max_threads) {
+  const int repeats = 64;
+  uint64_t start = ticks_now();
+  for (int r = 0; r < repeats; r++) { delay(r % max_threads); }
+  return ticks_to_ns(ticks_now() - start) / repeats;
+}
+
+typedef struct {
+  double lost_probability;
+  double mean_lost;
+} window_result_t;
+
+static window_result_t run_window(const config_t* config, thread_pool_t* pool, int thread_count) {
+  window_result_t result = { 0, 0 };
+  if (barrier_arm(config->barrier, thread_count) != 0) {
+    fprintf(stderr, "Unable to arm barrier '%s' for %d threads.\n", config->barrier->name, thread_count);
+    return result;
+  }
+
+  int failures = 0;
+  long long lost = 0;
+  for (int e = 0; e < config->experiments; e++) {
+    window_data = 0;
+    thread_pool_run(pool, thread_count, window_worker);
+    int missing = thread_count - window_data;
+    failures += missing > 0;
+    lost += missing;
+  }
+
+  result.lost_probability = (double) failures / config->experiments;
+  result.mean_lost = (double) lost / config->experiments;
+  return result;
+}
+
+void window_mode(const config_t* config, thread_pool_t* pool) {
+  table_printf("\n");
+  table_printf("Race Window Mode----------------------\n");
+  table_printf("|Delay |  Length | Window (ns) |Thread_Count | Experiments |  P(lost) | Mean Lost |\n");
+
+  chase = aligned_alloc(CACHE_LINE_SIZE, CHASE_BYTES);
+  cursors = aligned_alloc(CACHE_LINE_SIZE, sizeof(chase_cursor_t) * config->max_threads);
+  if (chase == NULL || cursors == NULL) {
+    fprintf(stderr, "Unable to allocate the pointer chase.\n");
+    free(chase);
+    free(cursors);
+    chase = NULL;
+    cursors = NULL;
+    return;
+  }
+  build_chase();
+  for (int t = 0; t < config->max_threads; t++) { cursors[t].cursor = (size_t) t * (CHASE_LINES / config->max_threads); }
+  start_line = barrier_wait_fn(config->barrier, config->barrier_order);
+
+  for (int k = 0; k < DELAY_COUNT; k++) {
+    delay_kind = (delay_kind_t) k;
+
+    for (int w = 0; w < config->window_count; w++) {
+      delay_length = config->windows[w];
+      double window_ns = measure_window(config->max_threads);
+
+      for (int c = 0; c < config->thread_count_len; c++) {
+        int thread_count = config->thread_counts[c];
+        if (thread_count < 2) { continue; }
+
+        window_result_t result = run_window(config, pool, thread_count);
+        table_printf("| %-5s| %7d | %11.1f | %10d  | %11d | %8.3f | %9.3f |\n",
+                     delay_names[k],
+                     delay_length,
+                     window_ns,
+                     thread_count,
+                     config->experiments,
+                     result.lost_probability,
+                     result.mean_lost);
+
+        report_field_t fields[] = {
+          REPORT_STRING("delay",            delay_names[k]),
+          REPORT_INT   ("length",           delay_length),
+          REPORT_DOUBLE("window_ns",        window_ns),
+          REPORT_INT   ("thread_count",     thread_count),
+          REPORT_INT   ("experiments",      config->experiments),
+          REPORT_DOUBLE("lost_probability", result.lost_probability),
+          REPORT_DOUBLE("mean_lost",        result.mean_lost),
+        };
+        report_row("window", fields, sizeof(fields) / sizeof(fields[0]));
+      }
+    }
+  }
+
+  free(cursors);
+  free(chase);
+  cursors = NULL;
+  chase = NULL;
+}